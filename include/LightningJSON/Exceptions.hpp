@@ -9,6 +9,10 @@ namespace LightningJSON
 	class JSONTypeMismatch;
 	class InvalidJSON;
 	class ArrayIndexOutOfRange;
+	class FileReadError;
+	class DepthLimitExceeded;
+	class NumberOutOfRange;
+	class FileWriteError;
 }
 
 class LightningJSON::JSONException : public std::exception
@@ -168,4 +172,56 @@ public:
 	{
 		return "Array index is out of range";
 	}
+};
+
+class LightningJSON::FileReadError : public JSONException
+{
+public:
+	virtual ~FileReadError() noexcept
+	{
+
+	}
+	virtual char const* what() const noexcept override
+	{
+		return "Could not read JSON file.";
+	}
+};
+
+class LightningJSON::DepthLimitExceeded : public JSONException
+{
+public:
+	virtual ~DepthLimitExceeded() noexcept
+	{
+
+	}
+	virtual char const* what() const noexcept override
+	{
+		return "Could not parse JSON: Nesting depth exceeds LIGHTNINGJSON_MAX_DEPTH.";
+	}
+};
+
+class LightningJSON::NumberOutOfRange : public JSONException
+{
+public:
+	virtual ~NumberOutOfRange() noexcept
+	{
+
+	}
+	virtual char const* what() const noexcept override
+	{
+		return "Number is out of range for the requested type.";
+	}
+};
+
+class LightningJSON::FileWriteError : public JSONException
+{
+public:
+	virtual ~FileWriteError() noexcept
+	{
+
+	}
+	virtual char const* what() const noexcept override
+	{
+		return "Could not write JSON output.";
+	}
 };
\ No newline at end of file
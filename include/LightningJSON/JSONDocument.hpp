@@ -0,0 +1,554 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "LightningJSON.hpp"
+
+namespace LightningJSON
+{
+	class JSONView;
+
+	// A read-only parse result stored as a single flat tape instead of a tree of Holders.
+	// Every value occupies two 64-bit entries:
+	//   [0] the JSONType in the top 8 bits, and the value's offset into the source in the rest
+	//   [1] for scalars, the length of the value's text;
+	//       for containers, the child count in the top 32 bits and the tape index one past
+	//       the container's last entry in the bottom 32 bits
+	// Object members are stored as a String entry for the key followed by the value.
+	// As with JSONObject::FromString, the source must outlive the document.
+	class JSONDocument
+	{
+	public:
+		static JSONDocument FromString(char const* const jsonStr, size_t const length)
+		{
+			return FromString(std::string_view(jsonStr, length));
+		}
+
+		static JSONDocument FromString(std::string_view const& jsonStr);
+
+		JSONView Root() const;
+
+		size_t TapeSize() const
+		{
+			return m_tape.size();
+		}
+
+	private:
+		friend class JSONView;
+
+		static constexpr uint64_t ms_offsetMask = (uint64_t(1) << 56) - 1;
+		static constexpr uint64_t ms_endMask = 0xFFFFFFFFULL;
+
+		JSONDocument()
+			: m_source(nullptr)
+			, m_tape()
+		{
+			//
+		}
+
+		uint32_t Append(JSONType type, char const* start, uint64_t extra)
+		{
+			uint32_t const index = uint32_t(m_tape.size());
+			m_tape.push_back((uint64_t(type) << 56) | uint64_t(start - m_source));
+			m_tape.push_back(extra);
+			return index;
+		}
+
+		// Estimates how many tape entries the input needs from how often ',', ':', '[' and '{'
+		// (each of which comes before a value or key) occur in its first few kilobytes.
+		static size_t EstimateEntries(std::string_view const& jsonStr);
+		void ParseKey(char const*& data, char const* end);
+		void Parse(char const* data, char const* end);
+
+		char const* m_source;
+		std::vector<uint64_t> m_tape;
+	};
+
+	// Lightweight handle to a value inside a JSONDocument. Views are only valid as long as
+	// the document they came from.
+	class JSONView
+	{
+	public:
+		class iterator;
+
+		JSONView()
+			: m_tape(nullptr)
+			, m_source(nullptr)
+			, m_index(0)
+		{
+			//
+		}
+
+		JSONType Type() const
+		{
+			return m_tape ? JSONType(m_tape[m_index] >> 56) : JSONType::Empty;
+		}
+
+		bool IsNull() const { return Type() == JSONType::Null; }
+		bool IsEmpty() const { return Type() == JSONType::Empty; }
+		bool IsInteger() const { return Type() == JSONType::Integer; }
+		bool IsString() const { return Type() == JSONType::String; }
+		bool IsDouble() const { return Type() == JSONType::Double; }
+		bool IsBool() const { return Type() == JSONType::Boolean; }
+		bool IsArray() const { return Type() == JSONType::Array; }
+		bool IsObject() const { return Type() == JSONType::Object; }
+
+		// The value's text exactly as it appears in the source; strings are still escaped.
+		std::string_view RawText() const
+		{
+			if (!m_tape || IsArray() || IsObject())
+			{
+				return std::string_view();
+			}
+			return std::string_view(m_source + (m_tape[m_index] & JSONDocument::ms_offsetMask), size_t(m_tape[m_index + 1]));
+		}
+
+		long long AsInt() const
+		{
+			CheckType(JSONType::Integer);
+			return JSONObject::ToInt(Data());
+		}
+
+		unsigned long long AsUnsigned() const
+		{
+			CheckType(JSONType::Integer);
+			return JSONObject::ToUInt(Data());
+		}
+
+		long long AsIntChecked() const
+		{
+			return JSONObject::ToIntChecked(Data(), Type());
+		}
+
+		unsigned long long AsUnsignedChecked() const
+		{
+			return JSONObject::ToUIntChecked(Data(), Type());
+		}
+
+		long double AsDouble() const
+		{
+			CheckType(JSONType::Double);
+			return JSONObject::ToDouble(Data());
+		}
+
+		double AsNativeDouble() const
+		{
+			CheckType(JSONType::Double);
+			return JSONObject::ToNativeDouble(Data());
+		}
+
+		bool AsBool() const
+		{
+			CheckType(JSONType::Boolean);
+			return JSONObject::ToBool(Data());
+		}
+
+		std::string AsString() const
+		{
+			CheckType(JSONType::String);
+			return JSONObject::UnescapeString(Data());
+		}
+
+		// Like AsString, but writes into out, reusing its capacity.
+		void UnescapeInto(std::string& out) const
+		{
+			CheckType(JSONType::String);
+			JSONObject::UnescapeInto(Data(), out);
+		}
+
+		size_t Size() const;
+
+		bool HasKey(std::string_view const& key) const
+		{
+			return !(*this)[key].IsEmpty();
+		}
+
+		JSONView operator[](char const* const key) const
+		{
+			return (*this)[std::string_view(key, strlen(key))];
+		}
+
+		JSONView operator[](std::string const& key) const
+		{
+			return (*this)[std::string_view(key.c_str(), key.length())];
+		}
+
+		JSONView operator[](std::string_view const& key) const;
+		JSONView operator[](size_t index) const;
+
+		iterator begin() const;
+		iterator end() const;
+
+	private:
+		friend class JSONDocument;
+
+		JSONView(uint64_t const* tape, char const* source, uint32_t index)
+			: m_tape(tape)
+			, m_source(source)
+			, m_index(index)
+		{
+			//
+		}
+
+		void CheckType(JSONType expected) const
+		{
+			if (Type() != expected)
+			{
+				throw JSONTypeMismatch(expected, Type());
+			}
+		}
+
+		StringData Data() const
+		{
+			std::string_view const text = RawText();
+			return StringData(text.data(), text.length());
+		}
+
+		// Tape index of the entry that follows this value, skipping any children.
+		static uint32_t NextIndex(uint64_t const* tape, uint32_t index)
+		{
+			JSONType const type = JSONType(tape[index] >> 56);
+			if (type == JSONType::Array || type == JSONType::Object)
+			{
+				return uint32_t(tape[index + 1] & JSONDocument::ms_endMask);
+			}
+			return index + 2;
+		}
+
+		uint64_t const* m_tape;
+		char const* m_source;
+		uint32_t m_index;
+	};
+
+	class JSONView::iterator
+	{
+	public:
+		iterator(uint64_t const* tape, char const* source, uint32_t index, bool isObject)
+			: m_tape(tape)
+			, m_source(source)
+			, m_index(index)
+			, m_isObject(isObject)
+		{
+			//
+		}
+
+		// Raw (still escaped) key text; empty when iterating an array.
+		std::string_view Key() const
+		{
+			if (!m_isObject)
+			{
+				return std::string_view();
+			}
+			return JSONView(m_tape, m_source, m_index).RawText();
+		}
+
+		JSONView Value() const
+		{
+			return JSONView(m_tape, m_source, m_isObject ? m_index + 2 : m_index);
+		}
+
+		JSONView operator*() const
+		{
+			return Value();
+		}
+
+		iterator& operator++()
+		{
+			m_index = JSONView::NextIndex(m_tape, m_isObject ? m_index + 2 : m_index);
+			return *this;
+		}
+
+		iterator operator++(int)
+		{
+			iterator tmp(*this);
+			++(*this);
+			return tmp;
+		}
+
+		bool operator==(iterator const& rhs) const
+		{
+			return m_index == rhs.m_index;
+		}
+
+		bool operator!=(iterator const& rhs) const
+		{
+			return m_index != rhs.m_index;
+		}
+
+	private:
+		uint64_t const* m_tape;
+		char const* m_source;
+		uint32_t m_index;
+		bool m_isObject;
+	};
+
+	inline JSONView JSONDocument::Root() const
+	{
+		if (m_tape.empty())
+		{
+			return JSONView();
+		}
+		return JSONView(m_tape.data(), m_source, 0);
+	}
+
+	inline JSONDocument JSONDocument::FromString(std::string_view const& jsonStr)
+	{
+		JSONDocument doc;
+		if (!jsonStr.data() || jsonStr.length() == 0)
+		{
+			return doc;
+		}
+
+		JSONObject::ValidateEncoding(jsonStr);
+		doc.m_source = jsonStr.data();
+		// Each entry is two words. An estimate that falls short only costs a regrowth.
+		doc.m_tape.reserve(2 * EstimateEntries(jsonStr));
+		doc.Parse(jsonStr.data(), jsonStr.data() + jsonStr.length());
+		return doc;
+	}
+
+	inline size_t JSONDocument::EstimateEntries(std::string_view const& jsonStr)
+	{
+		static constexpr size_t sampleSize = 4096;
+		size_t const sampled = jsonStr.length() < sampleSize ? jsonStr.length() : sampleSize;
+		size_t count = 0;
+		for (size_t i = 0; i < sampled; ++i)
+		{
+			char const c = jsonStr[i];
+			count += (c == ',' || c == ':' || c == '[' || c == '{') ? 1 : 0;
+		}
+		return count * jsonStr.length() / sampled + 1;
+	}
+
+	inline void JSONDocument::ParseKey(char const*& data, char const* end)
+	{
+		if (JSONObject::Peek(data, end) != '\"')
+		{
+			throw InvalidJSON();
+		}
+
+		char const* keyStart = data + 1;
+		JSONObject::CollectString(data, end);
+		Append(JSONType::String, keyStart, uint64_t(data - keyStart - 1));
+
+		JSONObject::SkipWhitespace(data, end);
+		if (JSONObject::Peek(data, end) != ':')
+		{
+			throw InvalidJSON();
+		}
+		++data;
+		JSONObject::SkipWhitespace(data, end);
+	}
+
+	// Iterative, so nesting depth is bounded by memory rather than the call stack.
+	inline void JSONDocument::Parse(char const* data, char const* end)
+	{
+		std::vector<uint32_t> open;
+
+		JSONObject::SkipWhitespace(data, end);
+
+		for (;;)
+		{
+			if (!open.empty())
+			{
+				m_tape[open.back() + 1] += uint64_t(1) << 32;
+			}
+
+			bool openedContainer = false;
+			switch (JSONObject::Peek(data, end))
+			{
+			case '{':
+			case '[':
+			{
+				bool const isObject = (*data == '{');
+				open.push_back(Append(isObject ? JSONType::Object : JSONType::Array, data, 0));
+				++data;
+				JSONObject::SkipWhitespace(data, end);
+				if (JSONObject::Peek(data, end) == (isObject ? '}' : ']'))
+				{
+					// Leave it on the stack; the close is handled below like any other.
+					break;
+				}
+				if (isObject)
+				{
+					ParseKey(data, end);
+				}
+				openedContainer = true;
+				break;
+			}
+			case '\"':
+			{
+				char const* startPoint = data + 1;
+				JSONObject::CollectString(data, end);
+				Append(JSONType::String, startPoint, uint64_t(data - startPoint - 1));
+				break;
+			}
+			case '+':
+			case '-':
+			case '0':
+			case '1':
+			case '2':
+			case '3':
+			case '4':
+			case '5':
+			case '6':
+			case '7':
+			case '8':
+			case '9':
+			case '.':
+			{
+				char const* startPoint = data;
+				detail_::NumberClass numberClass;
+				JSONType const type = JSONObject::ScanNumber(data, end, numberClass);
+				Append(type, startPoint, uint64_t(data - startPoint));
+				break;
+			}
+			case 't':
+			{
+				Append(JSONType::Boolean, data, 4);
+				JSONObject::SkipLiteral(data, end, "true");
+				break;
+			}
+			case 'f':
+			{
+				Append(JSONType::Boolean, data, 5);
+				JSONObject::SkipLiteral(data, end, "false");
+				break;
+			}
+			case 'n':
+			{
+				Append(JSONType::Null, data, 4);
+				JSONObject::SkipLiteral(data, end, "null");
+				break;
+			}
+			default:
+			{
+				throw InvalidJSON();
+			}
+			}
+
+			if (openedContainer)
+			{
+				continue;
+			}
+
+			// Close every container that ends here, then move on to the next sibling.
+			for (;;)
+			{
+				if (open.empty())
+				{
+					return;
+				}
+
+				JSONObject::SkipWhitespace(data, end);
+				uint32_t const top = open.back();
+				bool const isObject = (JSONType(m_tape[top] >> 56) == JSONType::Object);
+				char const close = isObject ? '}' : ']';
+
+				char const c = JSONObject::Peek(data, end);
+				if (c == close)
+				{
+					++data;
+					m_tape[top + 1] = (m_tape[top + 1] & ~ms_endMask) | uint64_t(m_tape.size());
+					open.pop_back();
+					continue;
+				}
+
+				if (c != ',')
+				{
+					throw InvalidJSON();
+				}
+				++data;
+				JSONObject::SkipWhitespace(data, end);
+
+				// Tolerate a trailing comma, as ParseContainer does.
+				if (JSONObject::Peek(data, end) == close)
+				{
+					continue;
+				}
+				if (isObject)
+				{
+					ParseKey(data, end);
+				}
+				break;
+			}
+		}
+	}
+
+	inline size_t JSONView::Size() const
+	{
+		switch (Type())
+		{
+		case JSONType::Object:
+		case JSONType::Array:
+			return size_t(m_tape[m_index + 1] >> 32);
+		case JSONType::Null:
+		case JSONType::Empty:
+			return 0;
+		case JSONType::Boolean:
+		case JSONType::Double:
+		case JSONType::Integer:
+		case JSONType::String:
+		default:
+			return 1;
+		}
+	}
+
+	inline JSONView JSONView::operator[](std::string_view const& key) const
+	{
+		if (!IsObject())
+		{
+			return JSONView();
+		}
+
+		uint32_t const end = uint32_t(m_tape[m_index + 1] & JSONDocument::ms_endMask);
+		uint32_t index = m_index + 2;
+		while (index < end)
+		{
+			if (JSONView(m_tape, m_source, index).RawText() == key)
+			{
+				return JSONView(m_tape, m_source, index + 2);
+			}
+			index = NextIndex(m_tape, index + 2);
+		}
+		return JSONView();
+	}
+
+	inline JSONView JSONView::operator[](size_t index) const
+	{
+		if (!IsArray() || index >= Size())
+		{
+			return JSONView();
+		}
+
+		uint32_t tapeIndex = m_index + 2;
+		for (size_t i = 0; i < index; ++i)
+		{
+			tapeIndex = NextIndex(m_tape, tapeIndex);
+		}
+		return JSONView(m_tape, m_source, tapeIndex);
+	}
+
+	inline JSONView::iterator JSONView::begin() const
+	{
+		if (!IsArray() && !IsObject())
+		{
+			return end();
+		}
+		return iterator(m_tape, m_source, m_index + 2, IsObject());
+	}
+
+	inline JSONView::iterator JSONView::end() const
+	{
+		if (!IsArray() && !IsObject())
+		{
+			return iterator(m_tape, m_source, m_index, false);
+		}
+		return iterator(m_tape, m_source, uint32_t(m_tape[m_index + 1] & JSONDocument::ms_endMask), IsObject());
+	}
+}
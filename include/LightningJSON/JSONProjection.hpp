@@ -0,0 +1,224 @@
+#pragma once
+
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stddef.h>
+
+namespace LightningJSON
+{
+	// A set of paths to keep when parsing, written as JSON pointers ("/user/id") where a
+	// segment may also be "*" to match every key of an object or every element of an array
+	// ("/items/*/price"). Numeric segments match array indices as well as object keys.
+	// Keys are matched against their text as written in the JSON source, before unescaping.
+	class JSONProjection
+	{
+	public:
+		class Node
+		{
+		public:
+			Node()
+				: m_children()
+				, m_wildcard()
+				, m_includesAll(false)
+			{
+				//
+			}
+
+			// True when a requested path ends here, so the whole subtree is kept.
+			bool IncludesAll() const
+			{
+				return m_includesAll;
+			}
+
+			Node const* Find(std::string_view const& key) const
+			{
+				for (auto& child : m_children)
+				{
+					if (child.key == key)
+					{
+						return child.node.get();
+					}
+				}
+				return m_wildcard.get();
+			}
+
+			Node const* FindIndex(size_t index) const
+			{
+				for (auto& child : m_children)
+				{
+					if (child.index == index)
+					{
+						return child.node.get();
+					}
+				}
+				return m_wildcard.get();
+			}
+
+		private:
+			friend class JSONProjection;
+
+			struct Child
+			{
+				std::string key;
+				size_t index;
+				std::unique_ptr<Node> node;
+			};
+
+			std::unique_ptr<Node> Clone() const
+			{
+				std::unique_ptr<Node> copy(new Node());
+				copy->m_includesAll = m_includesAll;
+				if (m_wildcard)
+				{
+					copy->m_wildcard = m_wildcard->Clone();
+				}
+				for (auto& child : m_children)
+				{
+					copy->m_children.push_back(Child{ child.key, child.index, child.node->Clone() });
+				}
+				return copy;
+			}
+
+			std::vector<Child> m_children;
+			std::unique_ptr<Node> m_wildcard;
+			bool m_includesAll;
+		};
+
+		JSONProjection()
+			: m_root()
+		{
+			//
+		}
+
+		JSONProjection(std::initializer_list<std::string_view> paths)
+			: m_root()
+		{
+			for (auto& path : paths)
+			{
+				Add(path);
+			}
+		}
+
+		void Add(std::string_view const& path)
+		{
+			// As in RFC 6901, only "" is the whole document. Every '/' begins a segment, even an
+			// empty one: "/" is the key "", and "/a/" is the key "" inside "a".
+			std::vector<std::string> segments;
+			if (!path.empty())
+			{
+				size_t pos = path[0] == '/' ? 1 : 0;
+				for (;;)
+				{
+					size_t end = path.find('/', pos);
+					if (end == std::string_view::npos)
+					{
+						end = path.length();
+					}
+					segments.push_back(Unescape(path.substr(pos, end - pos)));
+					if (end == path.length())
+					{
+						break;
+					}
+					pos = end + 1;
+				}
+			}
+			AddPath(m_root, segments, 0);
+		}
+
+		Node const* Root() const
+		{
+			return &m_root;
+		}
+
+	private:
+		// A wildcard has to apply to explicitly named siblings too, so paths are pushed into
+		// every branch they can reach, and new named branches start as a copy of the wildcard.
+		static void AddPath(Node& node, std::vector<std::string> const& segments, size_t depth)
+		{
+			if (node.m_includesAll)
+			{
+				return;
+			}
+
+			if (depth == segments.size())
+			{
+				node.m_includesAll = true;
+				node.m_children.clear();
+				node.m_wildcard.reset();
+				return;
+			}
+
+			std::string const& segment = segments[depth];
+			if (segment == "*")
+			{
+				if (!node.m_wildcard)
+				{
+					node.m_wildcard.reset(new Node());
+				}
+				AddPath(*node.m_wildcard, segments, depth + 1);
+				for (auto& child : node.m_children)
+				{
+					AddPath(*child.node, segments, depth + 1);
+				}
+				return;
+			}
+
+			for (auto& child : node.m_children)
+			{
+				if (child.key == segment)
+				{
+					AddPath(*child.node, segments, depth + 1);
+					return;
+				}
+			}
+
+			std::unique_ptr<Node> child(node.m_wildcard ? node.m_wildcard->Clone() : std::unique_ptr<Node>(new Node()));
+			AddPath(*child, segments, depth + 1);
+			node.m_children.push_back(Node::Child{ segment, ParseIndex(segment), std::move(child) });
+		}
+
+		// JSON pointer escapes: "~1" is '/', "~0" is '~'.
+		static std::string Unescape(std::string_view const& segment)
+		{
+			std::string result;
+			result.reserve(segment.length());
+			for (size_t i = 0; i < segment.length(); ++i)
+			{
+				if (segment[i] == '~' && i + 1 < segment.length() && (segment[i + 1] == '0' || segment[i + 1] == '1'))
+				{
+					result.push_back(segment[i + 1] == '0' ? '~' : '/');
+					++i;
+				}
+				else
+				{
+					result.push_back(segment[i]);
+				}
+			}
+			return result;
+		}
+
+		static size_t ParseIndex(std::string const& segment)
+		{
+			if (segment.empty() || segment.length() > 19)
+			{
+				return size_t(-1);
+			}
+			size_t index = 0;
+			for (char c : segment)
+			{
+				if (c < '0' || c > '9')
+				{
+					return size_t(-1);
+				}
+				index = index * 10 + size_t(c - '0');
+			}
+			return index;
+		}
+
+		Node m_root;
+	};
+}
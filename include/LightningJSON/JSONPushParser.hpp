@@ -0,0 +1,461 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stddef.h>
+#include <string.h>
+
+#include "LightningJSON.hpp"
+
+namespace LightningJSON
+{
+	// Parses a single JSON document that arrives in pieces, such as a request body read from a
+	// socket. Each chunk is consumed as it is fed; the parser keeps its place inside strings,
+	// numbers and nested containers between chunks.
+	//
+	// As with JSONObject::FromString, values are not copied out of the input: every chunk must
+	// outlive the resulting tree. The exception is a token that straddles two or more chunks,
+	// which is reassembled and committed to its own storage.
+	class JSONPushParser
+	{
+	public:
+		JSONPushParser()
+			: m_root()
+			, m_stack()
+			, m_pending()
+			, m_token(Token::None)
+			, m_expect(Expect::Value)
+			, m_escaped(false)
+			, m_done(false)
+			, m_partialSequence()
+			, m_partialLength(0)
+		{
+			//
+		}
+
+		JSONPushParser(JSONPushParser const&) = delete;
+		JSONPushParser& operator=(JSONPushParser const&) = delete;
+
+		void Feed(char const* const data, size_t const length);
+
+		void Feed(std::string_view const& chunk)
+		{
+			Feed(chunk.data(), chunk.length());
+		}
+
+		// True once a complete top-level value has been read. A top-level number is only known
+		// to be complete at Finish().
+		bool Done() const
+		{
+			return m_done;
+		}
+
+		// Ends the input and returns the document. Throws InvalidJSON if it is incomplete.
+		JSONObject Finish();
+
+	private:
+		enum class Token
+		{
+			None,
+			String,
+			Number,
+			Literal,
+		};
+
+		enum class Expect
+		{
+			Value,
+			ValueOrEnd,		// Just inside '[', or after a ',' in an array.
+			KeyOrEnd,		// Just inside '{', or after a ',' in an object.
+			Colon,
+			CommaOrEnd,
+		};
+
+		struct Frame
+		{
+			JSONObject container;
+			// For objects, the key of the member currently being read.
+			StringData key;
+		};
+
+		static bool IsNumberChar(char c)
+		{
+			return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+		}
+
+		static bool IsLiteralChar(char c)
+		{
+			return c >= 'a' && c <= 'z';
+		}
+
+		void BeginValue(char const*& data, char const* end);
+		void OpenContainer(JSONType type);
+		void CloseContainer();
+		// Links value into the container being read, or makes it the root.
+		void Attach(JSONObject& value);
+		// Advances data past the closing quote of the current string and returns true, or
+		// advances it to end and returns false if the string continues into the next chunk.
+		bool ScanString(char const*& data, char const* end);
+		void CompleteToken(StringData const& text);
+		// Throws InvalidJSON if the input is not valid UTF-8. A sequence split between chunks is
+		// held back and checked once the rest of it arrives.
+		void ValidateEncoding(char const* data, size_t length);
+
+		JSONObject m_root;
+		std::vector<Frame> m_stack;
+		// The part of the current token that arrived in earlier chunks.
+		std::string m_pending;
+		Token m_token;
+		Expect m_expect;
+		// Inside a string, whether the last character seen was an unpaired backslash.
+		bool m_escaped;
+		bool m_done;
+		// The start of a UTF-8 sequence that the last chunk ended in the middle of.
+		char m_partialSequence[4];
+		size_t m_partialLength;
+	};
+
+	inline bool JSONPushParser::ScanString(char const*& data, char const* end)
+	{
+		for (;;)
+		{
+			char const* const quote = static_cast<char const*>(memchr(data, '"', size_t(end - data)));
+			char const* const stop = quote ? quote : end;
+
+			// Only the run of backslashes just before stop matters. If it reaches back to data,
+			// it continues whatever run the previous scan ended with.
+			char const* backslash = stop;
+			while (backslash > data && *(backslash - 1) == '\\')
+			{
+				--backslash;
+			}
+			bool const oddRun = ((stop - backslash) & 1) != 0;
+			bool const escaped = backslash == data ? (m_escaped != oddRun) : oddRun;
+
+			if (!quote)
+			{
+				m_escaped = escaped;
+				data = end;
+				return false;
+			}
+
+			m_escaped = false;
+			data = quote + 1;
+			if (!escaped)
+			{
+				return true;
+			}
+		}
+	}
+
+	inline void JSONPushParser::Attach(JSONObject& value)
+	{
+		if (m_stack.empty())
+		{
+			m_root = value;
+			return;
+		}
+
+		Frame& top = m_stack.back();
+		if (top.container.m_holder->m_type == JSONType::Array)
+		{
+			top.container.m_holder->m_children.asArray.push_back(value);
+		}
+		else
+		{
+			value.m_key = top.key;
+			top.container.m_holder->m_children.asObject.Insert(top.key, value);
+		}
+	}
+
+	inline void JSONPushParser::OpenContainer(JSONType type)
+	{
+		// The same limit as FromString: the tree is freed recursively, so it must not be too deep.
+		if (m_stack.size() >= LIGHTNINGJSON_MAX_DEPTH)
+		{
+			throw DepthLimitExceeded();
+		}
+		JSONObject container(type);
+		Attach(container);
+		m_stack.push_back(Frame{ container, StringData() });
+		m_expect = type == JSONType::Array ? Expect::ValueOrEnd : Expect::KeyOrEnd;
+	}
+
+	inline void JSONPushParser::CloseContainer()
+	{
+		m_stack.pop_back();
+		m_done = m_stack.empty();
+		m_expect = Expect::CommaOrEnd;
+	}
+
+	inline void JSONPushParser::CompleteToken(StringData const& text)
+	{
+		Token const token = m_token;
+		m_token = Token::None;
+
+		if (m_expect == Expect::KeyOrEnd)
+		{
+			m_stack.back().key = text;
+			m_expect = Expect::Colon;
+			return;
+		}
+
+		JSONType type = JSONType::String;
+		detail_::NumberClass numberClass = detail_::NumberClass::Int64;
+		if (token == Token::Number)
+		{
+			char const* data = text.c_str();
+			type = JSONObject::ScanNumber(data, text.c_str() + text.length(), numberClass);
+#if LIGHTNINGJSON_STRICT
+			if (data != text.c_str() + text.length())
+			{
+				throw InvalidJSON();
+			}
+#endif
+		}
+		else if (token == Token::Literal)
+		{
+			std::string_view const literal = text.toStringView();
+			type = literal[0] == 'n' ? JSONType::Null : JSONType::Boolean;
+#if LIGHTNINGJSON_STRICT
+			if (literal != "null" && literal != "true" && literal != "false")
+			{
+				throw InvalidJSON();
+			}
+#endif
+		}
+
+		JSONObject value(type);
+		if (type != JSONType::Null)
+		{
+			value.m_holder->m_data = text;
+			value.m_holder->m_numberClass = numberClass;
+			value.m_holder->DetectEscapes();
+		}
+		Attach(value);
+		m_done = m_stack.empty();
+		m_expect = Expect::CommaOrEnd;
+	}
+
+	inline void JSONPushParser::BeginValue(char const*& data, char const* end)
+	{
+		char const* const start = data;
+		bool complete;
+		switch (*data)
+		{
+		case '{':
+			++data;
+			OpenContainer(JSONType::Object);
+			return;
+		case '[':
+			++data;
+			OpenContainer(JSONType::Array);
+			return;
+		case '"':
+			m_token = Token::String;
+			++data;
+			complete = ScanString(data, end);
+			break;
+		case 't':
+		case 'f':
+		case 'n':
+			m_token = Token::Literal;
+			while (data < end && IsLiteralChar(*data))
+			{
+				++data;
+			}
+			complete = data < end;
+			break;
+		default:
+			if (!IsNumberChar(*data))
+			{
+				throw InvalidJSON();
+			}
+			m_token = Token::Number;
+			while (data < end && IsNumberChar(*data))
+			{
+				++data;
+			}
+			complete = data < end;
+			break;
+		}
+
+		if (!complete)
+		{
+			m_pending.assign(start, end - start);
+			return;
+		}
+
+		// Strings are stored without their quotes.
+		size_t const trim = m_token == Token::String ? 1 : 0;
+		CompleteToken(StringData(start + trim, size_t(data - start) - 2 * trim));
+	}
+
+	inline void JSONPushParser::ValidateEncoding(char const* data, size_t length)
+	{
+		if (m_partialLength != 0)
+		{
+			size_t const sequenceLength = detail_::Utf8SequenceLength(static_cast<unsigned char>(m_partialSequence[0]));
+			size_t const missing = sequenceLength - m_partialLength;
+			size_t const count = missing < length ? missing : length;
+			memcpy(m_partialSequence + m_partialLength, data, count);
+			m_partialLength += count;
+			data += count;
+			length -= count;
+			if (m_partialLength < sequenceLength)
+			{
+				return;
+			}
+			if (!ValidateUtf8(m_partialSequence, sequenceLength))
+			{
+				throw InvalidJSON();
+			}
+			m_partialLength = 0;
+		}
+
+		size_t const tail = detail_::IncompleteUtf8Tail(data, length);
+		if (!ValidateUtf8(data, length - tail))
+		{
+			throw InvalidJSON();
+		}
+		memcpy(m_partialSequence, data + length - tail, tail);
+		m_partialLength = tail;
+	}
+
+	inline void JSONPushParser::Feed(char const* const chunk, size_t const length)
+	{
+#if LIGHTNINGJSON_STRICT
+		ValidateEncoding(chunk, length);
+#endif
+
+		char const* data = chunk;
+		char const* const end = chunk + length;
+
+		while (data < end)
+		{
+			if (m_token != Token::None)
+			{
+				// Finish a token that began in an earlier chunk.
+				char const* const start = data;
+				bool complete;
+				if (m_token == Token::String)
+				{
+					complete = ScanString(data, end);
+				}
+				else
+				{
+					bool const number = m_token == Token::Number;
+					while (data < end && (number ? IsNumberChar(*data) : IsLiteralChar(*data)))
+					{
+						++data;
+					}
+					complete = data < end;
+				}
+
+				m_pending.append(start, data - start);
+				if (!complete)
+				{
+					return;
+				}
+
+				size_t const trim = m_token == Token::String ? 1 : 0;
+				StringData text(m_pending.data() + trim, m_pending.length() - 2 * trim);
+				text.CommitStorage();
+				CompleteToken(text);
+				m_pending.clear();
+				continue;
+			}
+
+			char const c = *data;
+			if (detail_::IsWhitespace(c))
+			{
+				++data;
+				continue;
+			}
+
+			switch (m_expect)
+			{
+			case Expect::Value:
+				BeginValue(data, end);
+				break;
+			case Expect::ValueOrEnd:
+				if (c == ']')
+				{
+					++data;
+					CloseContainer();
+				}
+				else
+				{
+					BeginValue(data, end);
+				}
+				break;
+			case Expect::KeyOrEnd:
+				if (c == '}')
+				{
+					++data;
+					CloseContainer();
+				}
+				else if (c == '"')
+				{
+					BeginValue(data, end);
+				}
+				else
+				{
+					throw InvalidJSON();
+				}
+				break;
+			case Expect::Colon:
+				if (c != ':')
+				{
+					throw InvalidJSON();
+				}
+				++data;
+				m_expect = Expect::Value;
+				break;
+			case Expect::CommaOrEnd:
+			{
+				// Once the root value is complete, only whitespace may follow it.
+				if (m_stack.empty())
+				{
+					throw InvalidJSON();
+				}
+				bool const isArray = m_stack.back().container.m_holder->m_type == JSONType::Array;
+				if (c == ',')
+				{
+					m_expect = isArray ? Expect::ValueOrEnd : Expect::KeyOrEnd;
+				}
+				else if (c == (isArray ? ']' : '}'))
+				{
+					CloseContainer();
+				}
+				else
+				{
+					throw InvalidJSON();
+				}
+				++data;
+				break;
+			}
+			}
+		}
+	}
+
+	inline JSONObject JSONPushParser::Finish()
+	{
+		// A number or literal at the top level has nothing after it to mark its end.
+		if (m_token == Token::Number || m_token == Token::Literal)
+		{
+			StringData text(m_pending.data(), m_pending.length());
+			text.CommitStorage();
+			CompleteToken(text);
+			m_pending.clear();
+		}
+
+		if (m_token != Token::None || !m_done || m_partialLength != 0)
+		{
+			throw InvalidJSON();
+		}
+		return m_root;
+	}
+}
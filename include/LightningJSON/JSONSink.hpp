@@ -0,0 +1,109 @@
+#pragma once
+
+#include <functional>
+#include <utility>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifndef _WIN32
+#	include <unistd.h>
+#else
+#	include <io.h>
+#endif
+
+#include "Exceptions.hpp"
+
+namespace LightningJSON
+{
+	// Receives serialized JSON from JSONObject::WriteJSON, one chunk at a time, in order.
+	// Write may throw to abandon the output.
+	class JSONSink
+	{
+	public:
+		virtual ~JSONSink()
+		{
+			//
+		}
+
+		virtual void Write(char const* data, size_t length) = 0;
+	};
+
+	// Writes to a file descriptor, which is not closed by the sink. Throws FileWriteError if a write fails.
+	class FileDescriptorSink : public JSONSink
+	{
+	public:
+		explicit FileDescriptorSink(int fd)
+			: m_fd(fd)
+		{
+			//
+		}
+
+		virtual void Write(char const* data, size_t length) override
+		{
+			while (length != 0)
+			{
+#ifdef _WIN32
+				int const written = _write(m_fd, data, unsigned(length));
+#else
+				ssize_t const written = write(m_fd, data, length);
+#endif
+				if (written < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					throw FileWriteError();
+				}
+				data += written;
+				length -= size_t(written);
+			}
+		}
+
+	private:
+		int m_fd;
+	};
+
+	// Writes to a FILE*, which is not closed or flushed by the sink. Throws FileWriteError if a write fails.
+	class FileSink : public JSONSink
+	{
+	public:
+		explicit FileSink(FILE* file)
+			: m_file(file)
+		{
+			//
+		}
+
+		virtual void Write(char const* data, size_t length) override
+		{
+			if (fwrite(data, 1, length, m_file) != length)
+			{
+				throw FileWriteError();
+			}
+		}
+
+	private:
+		FILE* m_file;
+	};
+
+	// Hands each chunk to a function, for example to send it over a socket as it is produced.
+	class CallbackSink : public JSONSink
+	{
+	public:
+		explicit CallbackSink(std::function<void(char const*, size_t)> callback)
+			: m_callback(std::move(callback))
+		{
+			//
+		}
+
+		virtual void Write(char const* data, size_t length) override
+		{
+			m_callback(data, length);
+		}
+
+	private:
+		std::function<void(char const*, size_t)> m_callback;
+	};
+}
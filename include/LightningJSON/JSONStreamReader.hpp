@@ -0,0 +1,256 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "LightningJSON.hpp"
+
+namespace LightningJSON
+{
+	// Reads newline-delimited JSON (JSON Lines), one document per line. Blank lines are skipped.
+	//
+	// A reader over a buffer parses in place, like JSONObject::FromString, so the buffer must
+	// outlive the documents it yields. Each record is parsed against the end of its line, so the
+	// parser never reads into the next record. A reader over a FILE* parses out of its own
+	// buffer, which is refilled as the file is read; each document is only valid until the next
+	// call to Next().
+	//
+	// If the input ends partway through a record (for example, a log that was cut off mid-write),
+	// that record is not parsed; Next() returns false and Truncated() reports it. A malformed
+	// record anywhere else throws InvalidJSON: always if it is cut short or runs past its line,
+	// and for any other error when LIGHTNINGJSON_STRICT is enabled.
+	class JSONStreamReader
+	{
+	public:
+		explicit JSONStreamReader(std::string_view const& buffer)
+			: m_file(nullptr)
+			, m_buffer()
+			, m_pos(buffer.data())
+			, m_end(buffer.data() + buffer.length())
+			, m_lineNumber(0)
+			, m_eof(true)
+			, m_truncated(false)
+		{
+			//
+		}
+
+		JSONStreamReader(char const* const buffer, size_t const length)
+			: JSONStreamReader(std::string_view(buffer, length))
+		{
+			//
+		}
+
+		// The file is not closed by the reader.
+		explicit JSONStreamReader(FILE* file, size_t const chunkSize = ms_defaultChunkSize)
+			: m_file(file)
+			, m_buffer(chunkSize > 0 ? chunkSize : ms_defaultChunkSize)
+			, m_pos(m_buffer.data())
+			, m_end(m_buffer.data())
+			, m_lineNumber(0)
+			, m_eof(false)
+			, m_truncated(false)
+		{
+			//
+		}
+
+		JSONStreamReader(JSONStreamReader const&) = delete;
+		JSONStreamReader& operator=(JSONStreamReader const&) = delete;
+
+		// Parses the next record into record and returns true, or returns false at the end of
+		// the input. record is released before parsing, so the previous document's Holders are
+		// back in the pool and are reused for the next one.
+		bool Next(JSONObject& record);
+
+		// True when Next() stopped at an incomplete final record.
+		bool Truncated() const
+		{
+			return m_truncated;
+		}
+
+		// The 1-based line number of the record most recently returned (or rejected).
+		size_t LineNumber() const
+		{
+			return m_lineNumber;
+		}
+
+	private:
+		static constexpr size_t ms_defaultChunkSize = 1 << 20;
+
+		// Returns the end of the current line (its '\n', or m_end), reading more of the file if needed.
+		char const* FindLineEnd();
+		void Refill();
+		// Bounded check that every string and container opened in [data, end) is also closed
+		// there. Records that pass can be handed to the parser without it running past end.
+		static bool IsComplete(char const* data, char const* end);
+		static bool IsLineSpace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		FILE* m_file;
+		std::vector<char> m_buffer;
+		char const* m_pos;
+		char const* m_end;
+		size_t m_lineNumber;
+		bool m_eof;
+		bool m_truncated;
+	};
+
+	inline void JSONStreamReader::Refill()
+	{
+		char* const base = m_buffer.data();
+		size_t const remaining = size_t(m_end - m_pos);
+		if (remaining == m_buffer.size())
+		{
+			// A single line fills the whole buffer.
+			size_t const offset = size_t(m_pos - base);
+			m_buffer.resize(m_buffer.size() * 2);
+			m_pos = m_buffer.data() + offset;
+			m_end = m_pos + remaining;
+		}
+		else if (m_pos != base)
+		{
+			memmove(base, m_pos, remaining);
+			m_pos = base;
+			m_end = base + remaining;
+		}
+
+		char* const writePos = m_buffer.data() + remaining;
+		size_t const read = fread(writePos, 1, m_buffer.size() - remaining, m_file);
+		m_end = writePos + read;
+		if (read == 0)
+		{
+			m_eof = true;
+		}
+	}
+
+	inline char const* JSONStreamReader::FindLineEnd()
+	{
+		size_t searched = 0;
+		for (;;)
+		{
+			char const* const newline = static_cast<char const*>(memchr(m_pos + searched, '\n', size_t(m_end - m_pos) - searched));
+			if (newline || m_eof)
+			{
+				return newline ? newline : m_end;
+			}
+			searched = size_t(m_end - m_pos);
+			Refill();
+		}
+	}
+
+	inline bool JSONStreamReader::IsComplete(char const* data, char const* end)
+	{
+		int depth = 0;
+		while (data < end)
+		{
+			switch (*data++)
+			{
+			case '"':
+				for (;;)
+				{
+					char const* const quote = static_cast<char const*>(memchr(data, '"', size_t(end - data)));
+					if (!quote)
+					{
+						return false;
+					}
+					// The quote is escaped if it follows an odd number of backslashes.
+					char const* backslash = quote;
+					while (backslash > data && *(backslash - 1) == '\\')
+					{
+						--backslash;
+					}
+					data = quote + 1;
+					if (((quote - backslash) & 1) == 0)
+					{
+						break;
+					}
+				}
+				break;
+			case '{':
+			case '[':
+				++depth;
+				break;
+			case '}':
+			case ']':
+				--depth;
+				break;
+			default:
+				break;
+			}
+		}
+		return depth <= 0;
+	}
+
+	inline bool JSONStreamReader::Next(JSONObject& record)
+	{
+		record = JSONObject::GetEmpty();
+
+		for (;;)
+		{
+			if (m_pos == m_end && m_file && !m_eof)
+			{
+				Refill();
+			}
+			if (m_pos == m_end)
+			{
+				return false;
+			}
+
+			char const* const lineEnd = FindLineEnd();
+			bool const last = lineEnd == m_end;
+			char const* start = m_pos;
+			char const* end = lineEnd;
+			m_pos = last ? lineEnd : lineEnd + 1;
+			++m_lineNumber;
+
+			while (start < end && IsLineSpace(*start))
+			{
+				++start;
+			}
+			while (end > start && IsLineSpace(*(end - 1)))
+			{
+				--end;
+			}
+			if (start == end)
+			{
+				continue;
+			}
+
+			if (!IsComplete(start, end))
+			{
+				if (last)
+				{
+					m_truncated = true;
+					return false;
+				}
+				throw InvalidJSON();
+			}
+
+			JSONObject::ValidateEncoding(std::string_view(start, size_t(end - start)));
+
+			char const* data = start;
+			JSONType const type = JSONObject::TypeOfValue(*data);
+			if (type == JSONType::Null)
+			{
+				if (end - start != 4 || memcmp(start, "null", 4) != 0)
+				{
+					throw InvalidJSON();
+				}
+				record = JSONObject(JSONType::Null);
+				return true;
+			}
+
+			record = JSONObject(StringData(nullptr, 0), data, end, type, JSONObject::ParseMode::Eager);
+			if (data != end)
+			{
+				throw InvalidJSON();
+			}
+			return true;
+		}
+	}
+}
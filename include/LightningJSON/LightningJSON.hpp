@@ -31,15 +31,25 @@
 #	error LightningJSON requires c++17 support
 #endif
 
-#include <sstream>
+#include <atomic>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include <stddef.h>
 
 #include "Exceptions.hpp"
 #include "JSONType.hpp"
+#include "JSONProjection.hpp"
+#include "JSONSink.hpp"
+#include "Number.hpp"
+#include "OutputBuffer.hpp"
+#include "Simd.hpp"
+#include "SourceBuffer.hpp"
+#include "StructuralIndex.hpp"
+#include "ThreadPool.hpp"
+#include "Utf8.hpp"
 
 #include "third-party/SkipProbe/SkipProbe.hpp"
 
@@ -47,6 +57,11 @@
 #	define LIGHTNINGJSON_STRICT 0
 #endif
 
+// Documents nested deeper than this throw DepthLimitExceeded.
+#ifndef LIGHTNINGJSON_MAX_DEPTH
+#	define LIGHTNINGJSON_MAX_DEPTH 1024
+#endif
+
 #ifndef LIGHTNINGJSON_CHECKED
 #	define LIGHTNINJSON_CHECKED 1
 #endif
@@ -199,10 +214,22 @@ namespace LightningJSON
 	public:
 		static long long ToInt(StringData const& str);
 		static unsigned long long ToUInt(StringData const& str);
+		// Like ToInt and ToUInt, for text parsed as the given type. Integers too large for 64 bits
+		// are parsed as doubles, so those are accepted too. Throws NumberOutOfRange if the value
+		// does not fit, and JSONTypeMismatch if it is not an integer at all.
+		static long long ToIntChecked(StringData const& str, JSONType type);
+		static unsigned long long ToUIntChecked(StringData const& str, JSONType type);
 		static long double ToDouble(StringData const& str);
+		// The nearest double to the number, correctly rounded.
+		static double ToNativeDouble(StringData const& str);
 		static bool ToBool(StringData const& str);
 		static std::string EscapeString(StringData const& str);
 		static std::string UnescapeString(StringData const& str);
+		// Like UnescapeString, but writes into out, reusing its capacity.
+		static void UnescapeInto(StringData const& str, std::string& out);
+		// Unescapes [data, data + length) into out and returns the length written, which is
+		// never more than length. out may be data itself.
+		static size_t Unescape(char const* data, size_t length, char* out);
 
 		std::string_view GetKey() const
 		{
@@ -218,7 +245,7 @@ namespace LightningJSON
 			}
 #endif
 
-			return ToInt(m_holder->m_data);
+			return (long long)(m_holder->ConvertedBits());
 		}
 
 		unsigned long long AsUnsigned() const
@@ -230,7 +257,27 @@ namespace LightningJSON
 			}
 #endif
 
-			return ToUInt(m_holder->m_data);
+			return m_holder->ConvertedBits();
+		}
+
+		// As AsInt, but throws NumberOutOfRange rather than wrapping when the value does not fit.
+		long long AsIntChecked() const
+		{
+			if (m_holder->m_type == JSONType::Integer && m_holder->m_numberClass == detail_::NumberClass::Int64)
+			{
+				return (long long)(m_holder->ConvertedBits());
+			}
+			return ToIntChecked(m_holder->m_data, m_holder->m_type);
+		}
+
+		// As AsUnsigned, but throws NumberOutOfRange for negative values and values that do not fit.
+		unsigned long long AsUnsignedChecked() const
+		{
+			if (m_holder->m_type == JSONType::Integer && m_holder->m_numberClass == detail_::NumberClass::UInt64)
+			{
+				return m_holder->ConvertedBits();
+			}
+			return ToUIntChecked(m_holder->m_data, m_holder->m_type);
 		}
 
 		void Val(signed char& value) const
@@ -290,12 +337,12 @@ namespace LightningJSON
 
 		void Val(double& value) const
 		{
-			value = (double)AsDouble();
+			value = AsNativeDouble();
 		}
 
 		void Val(float& value) const
 		{
-			value = float(AsDouble());
+			value = float(AsNativeDouble());
 		}
 
 		void Val(long double& value) const
@@ -310,9 +357,9 @@ namespace LightningJSON
 
 		void Val(char* value, size_t length) const
 		{
-			std::string data = AsString();
+			std::string_view data = AsStringView();
 			size_t copyLength = length < data.length() ? length : data.length();
-			memcpy(value, data.c_str(), copyLength);
+			memcpy(value, data.data(), copyLength);
 			value[copyLength] = '\0';
 		}
 
@@ -325,7 +372,44 @@ namespace LightningJSON
 			}
 #endif
 
-			return UnescapeString(m_holder->m_data);
+			return std::string(AsStringView());
+		}
+
+		// Like AsString, but writes into out, reusing its capacity.
+		void UnescapeInto(std::string& out) const
+		{
+#ifdef LIGHTNINGJSON_STRICT
+			if (m_holder->m_type != JSONType::String)
+			{
+				throw JSONTypeMismatch(JSONType::String, m_holder->m_type);
+			}
+#endif
+
+			if (!m_holder->m_hasEscapes)
+			{
+				out.assign(m_holder->m_data.c_str(), m_holder->m_data.length());
+				return;
+			}
+			UnescapeInto(m_holder->m_data, out);
+		}
+
+		// The unescaped string without copying it. A string with no escapes is viewed where it
+		// was parsed, so the view lasts as long as the parsed text; otherwise it views a copy
+		// kept with the value, which lasts as long as the value.
+		std::string_view AsStringView() const
+		{
+#ifdef LIGHTNINGJSON_STRICT
+			if (m_holder->m_type != JSONType::String)
+			{
+				throw JSONTypeMismatch(JSONType::String, m_holder->m_type);
+			}
+#endif
+
+			if (!m_holder->m_hasEscapes)
+			{
+				return std::string_view(m_holder->m_data.c_str(), m_holder->m_data.length());
+			}
+			return *reinterpret_cast<std::string const*>(uintptr_t(m_holder->ConvertedBits()));
 		}
 
 		bool AsBool() const
@@ -337,19 +421,53 @@ namespace LightningJSON
 			}
 #endif
 
-			return ToBool(m_holder->m_data);
+			return m_holder->ConvertedBits() != 0;
 		}
 
+		// Integers can also be read as doubles.
 		long double AsDouble() const
 		{
 #ifdef LIGHTNINGJSON_STRICT
-			if (m_holder->m_type != JSONType::Double)
+			if (m_holder->m_type != JSONType::Double && m_holder->m_type != JSONType::Integer)
+			{
+				throw JSONTypeMismatch(JSONType::Double, m_holder->m_type);
+			}
+#endif
+
+			if (m_holder->m_type == JSONType::Integer)
+			{
+				uint64_t const bits = m_holder->ConvertedBits();
+				if (m_holder->m_numberClass == detail_::NumberClass::UInt64)
+				{
+					return (long double)(bits);
+				}
+				return (long double)((long long)(bits));
+			}
+			return (long double)(AsNativeDouble());
+		}
+
+		// As AsDouble, but converts directly to double without going through long double.
+		double AsNativeDouble() const
+		{
+#ifdef LIGHTNINGJSON_STRICT
+			if (m_holder->m_type != JSONType::Double && m_holder->m_type != JSONType::Integer)
 			{
 				throw JSONTypeMismatch(JSONType::Double, m_holder->m_type);
 			}
 #endif
 
-			return ToDouble(m_holder->m_data);
+			uint64_t const bits = m_holder->ConvertedBits();
+			if (m_holder->m_type == JSONType::Integer)
+			{
+				if (m_holder->m_numberClass == detail_::NumberClass::UInt64)
+				{
+					return double(bits);
+				}
+				return double((long long)(bits));
+			}
+			double value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
 		}
 
 		JSONObject& NextSibling();
@@ -432,27 +550,43 @@ namespace LightningJSON
 
 		bool HasKey(char const* const key) const
 		{
+			EnsureParsed();
 			return IsObject() && m_holder->m_children.asObject.Contains(StringData(key, strlen(key)));
 		}
 
 		bool HasKey(char const* const key, size_t length) const
 		{
+			EnsureParsed();
 			return IsObject() && m_holder->m_children.asObject.Contains(StringData(key, length));
 		}
 
 		bool HasKey(std::string const& key) const
 		{
+			EnsureParsed();
 			return IsObject() && m_holder->m_children.asObject.Contains(StringData(key.data(), key.length()));
 		}
 
 		bool HasKey(std::string_view const& key) const
 		{
+			EnsureParsed();
 			return IsObject() && m_holder->m_children.asObject.Contains(StringData(key.data(), key.length()));
 		}
 
 		size_t Size();
 
 		std::string ToJSONString(bool pretty = false);
+		// Writes the JSON into out, replacing its contents but reusing its capacity, so a
+		// string kept per thread stops allocating once it fits the largest response.
+		void ToJSONString(std::string& out, bool pretty = false);
+		// Writes the JSON to sink as the tree is walked, in chunks of chunkSize bytes (the last one
+		// may be shorter), so the whole output is never held in memory at once.
+		void WriteJSON(JSONSink& sink, bool pretty = false, size_t chunkSize = ms_defaultWriteChunkSize);
+		// The exact length of ToJSONString(pretty), found by walking the tree without writing
+		// anything, for example to size a send buffer up front.
+		size_t SerializedSize(bool pretty = false);
+		// Writes exactly SerializedSize(pretty) characters to buffer, which must have room for
+		// them, and returns that length. Nothing is allocated and no terminator is written.
+		size_t WriteJSON(char* buffer, bool pretty = false);
 
 		JSONObject& PushBack(JSONObject const& token);
 		JSONObject& PushBack(signed char value) { return PushBack((long long)(value)); }
@@ -617,37 +751,93 @@ namespace LightningJSON
 				return GetEmpty();
 			}
 
+			ValidateEncoding(jsonStr);
 			char const* data = jsonStr.data();
-			SkipWhitespace(data);
-			JSONType type = JSONType::Empty;
-			switch (data[0])
-			{
-			case '{': type = JSONType::Object; break;
-			case '[': type = JSONType::Array; break;
-			case '"': type = JSONType::String; break;
-			case 't':
-			case 'f': type = JSONType::Boolean; break;
-			case 'n': type = JSONType::Null; break;
-			case '+':
-			case '-':
-			case '0':
-			case '1':
-			case '2':
-			case '3':
-			case '4':
-			case '5':
-			case '6':
-			case '7':
-			case '8':
-			case '9':
-			case '.':
-				type = JSONType::Integer; break;
-			default:
-				throw InvalidJSON();
+			char const* const end = data + jsonStr.length();
+			SkipWhitespace(data, end);
+			return JSONObject(StringData(nullptr, 0), data, end, TypeOfValue(Peek(data, end)), ParseMode::Eager);
+		}
+
+		// Same as FromString, but each string value is unescaped as it is parsed by writing over
+		// its own text in jsonStr, so AsStringView never needs a copy. Object keys are left as
+		// written. jsonStr is modified and, as with FromString, must outlive the returned object.
+		static JSONObject FromStringInSitu(char* const jsonStr, size_t const length)
+		{
+			if (!jsonStr || length == 0)
+			{
+				return GetEmpty();
 			}
-			return JSONObject(StringData(nullptr, 0), data, type);
+
+			ValidateEncoding(std::string_view(jsonStr, length));
+			char const* data = jsonStr;
+			char const* const end = data + length;
+			SkipWhitespace(data, end);
+			return JSONObject(StringData(nullptr, 0), data, end, TypeOfValue(Peek(data, end)), ParseMode::InSitu);
+		}
+
+		// Same as FromString, but only the values at the paths in the projection are kept.
+		// Everything else is skipped with a bracket-matching scan and never allocated.
+		static JSONObject FromString(char const* const jsonStr, size_t const length, JSONProjection const& projection)
+		{
+			return FromString(std::string_view(jsonStr, length), projection);
+		}
+
+		static JSONObject FromString(std::string_view const& jsonStr, JSONProjection const& projection);
+
+		// Same as FromString, but nested objects and arrays are only skimmed to find where they
+		// end. Their contents are parsed the first time they are accessed, so documents where
+		// only a few fields are read skip most of the work.
+		// Because of this, a lazily parsed tree must not be read from several threads at once.
+		static JSONObject FromStringLazy(char const* const jsonStr, size_t const length)
+		{
+			return FromStringLazy(std::string_view(jsonStr, length));
+		}
+
+		static JSONObject FromStringLazy(std::string_view const& jsonStr);
+
+		// Same as FromString, but when the root is a large array its elements are split into spans
+		// with a quick skim and the spans are parsed on the thread pool. Anything else is parsed
+		// normally on the calling thread.
+		static JSONObject FromStringParallel(char const* const jsonStr, size_t const length, ThreadPool& pool = ThreadPool::Shared())
+		{
+			return FromStringParallel(std::string_view(jsonStr, length), pool);
+		}
+
+		static JSONObject FromStringParallel(std::string_view const& jsonStr, ThreadPool& pool = ThreadPool::Shared());
+
+		// Parses many independent documents on the thread pool and returns them in input order.
+		// As with FromString, each document's text must outlive its tree. If any document is
+		// invalid, the exception is rethrown once the whole batch has finished.
+		static std::vector<JSONObject> ParseBatch(std::string_view const* documents, size_t const count, ThreadPool& pool = ThreadPool::Shared());
+
+		static std::vector<JSONObject> ParseBatch(std::vector<std::string_view> const& documents, ThreadPool& pool = ThreadPool::Shared())
+		{
+			return ParseBatch(documents.data(), documents.size(), pool);
+		}
+
+		// Parses a file in place through a read-only memory mapping. The returned object owns the
+		// mapping, which is released once it and every copy of it have been destroyed. As with
+		// FromString, values taken from the tree (including ShallowCopy and DeepCopy results)
+		// point into the text, so the root must outlive them.
+		// Throws FileReadError if the file cannot be opened.
+		static JSONObject FromFile(char const* path);
+
+		static JSONObject FromFile(std::string const& path)
+		{
+			return FromFile(path.c_str());
+		}
+
+		// Same as FromString, but first classifies the whole input in 64-byte blocks to build
+		// an index of structural characters, then builds the tree by jumping between them.
+		// Faster than FromString for large documents; the same lifetime rules apply. Documents
+		// over 4GB are parsed with FromString instead.
+		static JSONObject FromStringIndexed(char const* const jsonStr, size_t const length)
+		{
+			return FromStringIndexed(std::string_view(jsonStr, length));
 		}
 
+		static JSONObject FromStringIndexed(std::string_view const& jsonStr);
+
 		~JSONObject();
 
 		JSONObject();
@@ -757,7 +947,16 @@ namespace LightningJSON
 		JSONObject DeepCopy();
 
 	protected:
-		JSONObject(StringData const& myKey, char const*& data, JSONType expectedType);
+		enum class ParseMode
+		{
+			Eager,		// Parse the value and everything inside it.
+			Lazy,		// Parse the value's own children, but defer any containers among them.
+			Deferred,	// For containers, only find the end and keep the text for later.
+			InSitu,		// As Eager, but unescape strings over their source text, which must be writable.
+		};
+
+		JSONObject(StringData const& myKey, char const*& data, char const* end, JSONType expectedType, ParseMode mode, JSONProjection::Node const* filter = nullptr);
+		JSONObject(StringData const& myKey, StructuralIndex::Cursor& cursor, size_t depth, JSONType expectedType);
 		JSONObject(JSONType statedType, char const* data);
 		JSONObject(JSONType statedType, char const* data, size_t length);
 		JSONObject(JSONType statedType, std::string const& data);
@@ -777,7 +976,21 @@ namespace LightningJSON
 		JSONObject(StringData const& myKey, JSONObject const& other);
 
 	private:
-		void BuildJSONString(std::stringstream& outString, bool pretty, int tabDepth);
+		friend class JSONDocument;
+		friend class JSONStreamReader;
+		friend class JSONPushParser;
+
+		static constexpr size_t ms_defaultWriteChunkSize = 64 * 1024;
+
+		// t_Output is detail_::OutputBuffer or detail_::UncheckedOutputBuffer.
+		template<typename t_Output>
+		void BuildJSONString(t_Output& out, bool pretty, int tabDepth);
+		template<typename t_Output>
+		static void EscapeInto(t_Output& out, StringData const& str);
+		// The length BuildJSONString will produce.
+		size_t MeasureJSONString(bool pretty, int tabDepth);
+		// The length EscapeInto will produce.
+		static size_t EscapedLength(StringData const& str);
 		void IncRef()
 		{
 			++m_holder->refCount;
@@ -790,38 +1003,144 @@ namespace LightningJSON
 			}
 		}
 
-		static void SkipWhitespace(char const*& data);
-		static void CollectString(char const*& data);
-		void ParseString(char const*& data);
-		void ParseNumber(char const*& data);
-		void ParseBool(char const*& data);
-		void ParseArray(char const*& data);
-		void ParseObject(char const*& data);
+		// In strict mode, rejects input that is not valid UTF-8. Compiles away otherwise.
+		static void ValidateEncoding(std::string_view const& jsonStr)
+		{
+#if LIGHTNINGJSON_STRICT
+			if (!ValidateUtf8(jsonStr))
+			{
+				throw InvalidJSON();
+			}
+#else
+			(void)jsonStr;
+#endif
+		}
+
+		// Returns the character at data, or '\0' once data has reached end. The scanners below
+		// never read at or past end, so the input needs no terminator.
+		static char Peek(char const* data, char const* end)
+		{
+			return data < end ? *data : '\0';
+		}
+		// Advances past literal ("true", "false" or "null"), whose first character has been
+		// matched already. Throws InvalidJSON if the input ends first, whatever the mode, or in
+		// strict mode if the rest of the text differs.
+		static void SkipLiteral(char const*& data, char const* end, std::string_view const& literal);
+		static void SkipWhitespace(char const*& data, char const* end);
+		// Advances past a string and returns whether it contains any escape sequences. Throws
+		// InvalidJSON if the input ends first.
+		static bool CollectString(char const*& data, char const* end);
+		static void SkipContainer(char const*& data, char const* end);
+		static void SkipValue(char const*& data, char const* end);
+		// Returns the type a value will be parsed as, given its first character.
+		static JSONType TypeOfValue(char c);
+		// Decides whether a child of a projected container is kept; if so, sets childFilter to
+		// the filter for its contents (nullptr when the whole child is kept).
+		static bool SelectChild(JSONProjection::Node const* match, char first, JSONProjection::Node const*& childFilter);
+		// Parses one array element, as ParseContainer does.
+		static JSONObject ParseElement(char const*& data, char const* end);
+		// Advances past a number and classifies it. Integers that do not fit in 64 bits are
+		// reported as doubles. In strict mode, anything outside the JSON number grammar throws.
+		static JSONType ScanNumber(char const*& data, char const* end, detail_::NumberClass& numberClass);
+		void ParseString(char const*& data, char const* end, bool inSitu);
+		void ParseNumber(char const*& data, char const* end);
+		void ParseBool(char const*& data, char const* end);
+		// Parses an array or object (and, unless mode is Lazy, everything inside it) without
+		// recursion, keeping the open containers on an explicit stack.
+		void ParseContainer(char const*& data, char const* end, ParseMode mode, JSONProjection::Node const* filter);
+		void ParseDeferred() const;
+
+		void EnsureParsed() const
+		{
+			if (m_holder->m_deferred)
+			{
+				ParseDeferred();
+			}
+		}
+		void ParseIndexedArray(StructuralIndex::Cursor& cursor, size_t depth);
+		void ParseIndexedObject(StructuralIndex::Cursor& cursor, size_t depth);
 
 		struct Holder
 		{
 			StringData m_data;
 			JSONType m_type;
+			// Set on the root returned by FromFile, which was made by CreateWithSource and frees
+			// the source with itself.
+			bool m_ownsSource;
 			union Children
 			{
 				TokenMap asObject;
 				TokenList asArray;
 				std::nullptr_t asNull;
+				// Scalars leave the containers' space unused, so their own state lives here instead.
+				struct Scalar
+				{
+					// The text of a number built in code; m_data points here rather than at a heap copy.
+					char text[detail_::FormattedNumberSize];
+					// The value, cached by the first accessor to read it: the integer (as unsigned),
+					// the bits of the double, 0 or 1, or for a string with escapes, a pointer to its
+					// unescaped copy.
+					std::atomic<uint64_t> converted;
+				} asScalar;
 				// Construction and destruction handled in Holder constructor/destructor.
 				Children() : asNull(nullptr) {}
 				~Children() {}
 			} m_children;
 			int refCount;
+			// Set for containers whose children have not been parsed yet; m_data holds their text
+			// and m_children has not been constructed.
+			bool m_deferred;
+			// For numbers, how m_data is converted; set by the parser so the accessors need not re-scan it.
+			detail_::NumberClass m_numberClass;
+			// For strings, whether m_data contains a backslash and so differs from its unescaped value.
+			bool m_hasEscapes;
+			// Set once m_children.asScalar.converted holds the value of m_data. Both are atomic so
+			// that threads reading the same scalar of a fully parsed tree, through references
+			// rather than copies, may fill the cache at once. Nothing else about a JSONObject is
+			// safe to share between threads: the reference count is not atomic, and deferred
+			// containers are parsed on first access.
+			std::atomic<bool> m_isConverted;
 
 			bool Unique() { return refCount == 1; }
 
 			Holder(JSONType forType);
+			Holder(JSONType forType, bool deferred);
+			void InitChildren();
+			// Copies the type-specific state of a scalar: its text, number class and cached value.
+			void CopyScalar(Holder const* other);
+			void SetConverted(uint64_t bits);
+			// Points m_data at the first length characters of m_children.asScalar.text.
+			void SetInlineText(size_t length);
+
+			uint64_t ConvertedBits()
+			{
+				if (!m_isConverted.load(std::memory_order_acquire))
+				{
+					Convert();
+				}
+				return m_children.asScalar.converted.load(std::memory_order_relaxed);
+			}
+
+			void Convert();
+			void DetectEscapes();
 			static Holder* Create();
+			// Allocates room for a Holder followed by a pointer to source, for the root of a tree
+			// that owns the text it was parsed from.
+			static Holder* CreateWithSource(detail_::SourceBuffer* source);
+			static detail_::SourceBuffer*& SourceOf(Holder* holder);
 			static void Free(Holder* holder);
 
 			~Holder();
 		};
 
+		// The same as the parsing constructor above, but parses into holder, which has been
+		// allocated but not constructed.
+		JSONObject(Holder* holder, StringData const& myKey, char const*& data, char const* end, JSONType expectedType, ParseMode mode, JSONProjection::Node const* filter = nullptr);
+
+		// Appends to an array, or inserts under key into an object, constructing the child from args.
+		template<typename... t_Args>
+		static void AddChild(Holder* container, StringData const& key, t_Args&&... args);
+
 		Holder* m_holder;
 		StringData m_key;
 		static JSONObject const& GetEmpty()
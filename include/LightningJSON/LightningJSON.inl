@@ -1,4 +1,3 @@
-#include <cmath>
 #include <stdlib.h>
 
 #include "PoolAllocator.hpp"
@@ -11,6 +10,7 @@ namespace LightningJSON
 {
 	inline JSONObject const& JSONObject::operator[](std::string_view const& key) const
 	{
+		EnsureParsed();
 		if (m_holder->m_type != JSONType::Object)
 		{
 			return GetEmpty();
@@ -28,6 +28,7 @@ namespace LightningJSON
 
 	inline JSONObject const& JSONObject::operator[](size_t index) const
 	{
+		EnsureParsed();
 		if (m_holder->m_type != JSONType::Array || index >= m_holder->m_children.asArray.size())
 		{
 			return GetEmpty();
@@ -38,6 +39,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::operator[](std::string_view const& key)
 	{
+		EnsureParsed();
 		// Allow converting an empty node to an object node.
 		if (m_holder->m_type == JSONType::Empty)
 		{
@@ -63,6 +65,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::operator[](size_t index)
 	{
+		EnsureParsed();
 		// Allow converting an empty node to an object node.
 		if (m_holder->m_type == JSONType::Empty)
 		{
@@ -84,6 +87,7 @@ namespace LightningJSON
 
 	inline size_t JSONObject::Size()
 	{
+		EnsureParsed();
 		switch (m_holder->m_type)
 		{
 		case JSONType::Object:
@@ -112,13 +116,40 @@ namespace LightningJSON
 
 	inline std::string JSONObject::ToJSONString(bool pretty)
 	{
-		std::stringstream outString;
-		BuildJSONString(outString, pretty, 1);
-		return outString.str();
+		std::string result;
+		ToJSONString(result, pretty);
+		return result;
+	}
+
+	inline void JSONObject::ToJSONString(std::string& out, bool pretty)
+	{
+		detail_::OutputBuffer buffer(out);
+		BuildJSONString(buffer, pretty, 1);
+		buffer.Finish();
+	}
+
+	inline void JSONObject::WriteJSON(JSONSink& sink, bool pretty, size_t chunkSize)
+	{
+		detail_::OutputBuffer buffer(sink, chunkSize);
+		BuildJSONString(buffer, pretty, 1);
+		buffer.Finish();
+	}
+
+	inline size_t JSONObject::SerializedSize(bool pretty)
+	{
+		return MeasureJSONString(pretty, 1);
+	}
+
+	inline size_t JSONObject::WriteJSON(char* buffer, bool pretty)
+	{
+		detail_::UncheckedOutputBuffer out(buffer);
+		BuildJSONString(out, pretty, 1);
+		return out.Size();
 	}
 
 	inline JSONObject& JSONObject::PushBack(JSONObject const& token)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Array)
 		{
@@ -131,6 +162,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::PushBack(unsigned long long value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Array)
 		{
@@ -143,6 +175,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::PushBack(long long value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Array)
 		{
@@ -155,6 +188,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::PushBack(long double value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Array)
 		{
@@ -167,6 +201,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::PushBack(bool value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Array)
 		{
@@ -179,6 +214,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::PushBack(const char* const value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Array)
 		{
@@ -191,6 +227,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::PushBack(const char* const value, size_t length)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Array)
 		{
@@ -203,6 +240,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::PushBack(std::string const& value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Array)
 		{
@@ -215,6 +253,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::PushBack(std::string_view const& value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Array)
 		{
@@ -227,6 +266,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::Insert(std::string_view const& name, JSONObject const& token)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Object)
 		{
@@ -241,6 +281,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::Insert(std::string_view const& name, unsigned long long value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Object)
 		{
@@ -255,6 +296,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::Insert(std::string_view const& name, long long value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Object)
 		{
@@ -269,6 +311,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::Insert(std::string_view const& name, long double value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Object)
 		{
@@ -283,6 +326,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::Insert(std::string_view const& name, bool value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Object)
 		{
@@ -297,6 +341,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::Insert(std::string_view const& name, const char* const value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Object)
 		{
@@ -311,6 +356,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::Insert(std::string_view const& name, const char* const value, size_t length)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Object)
 		{
@@ -325,6 +371,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::Insert(std::string_view const& name, std::string const& value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Object)
 		{
@@ -339,6 +386,7 @@ namespace LightningJSON
 
 	inline JSONObject& JSONObject::Insert(std::string_view const& name, std::string_view const& value)
 	{
+		EnsureParsed();
 #if LIGHTNINJSON_CHECKED
 		if (m_holder->m_type != JSONType::Object)
 		{
@@ -358,6 +406,7 @@ namespace LightningJSON
 		::new(m_holder) Holder(statedType);
 		m_holder->m_data = StringData(data);
 		m_holder->m_data.CommitStorage();
+		m_holder->DetectEscapes();
 	}
 
 	inline JSONObject::JSONObject(JSONType statedType, char const* data, size_t length)
@@ -367,6 +416,7 @@ namespace LightningJSON
 		::new(m_holder) Holder(statedType);
 		m_holder->m_data = StringData(data, length);
 		m_holder->m_data.CommitStorage();
+		m_holder->DetectEscapes();
 	}
 
 	inline JSONObject::JSONObject(JSONType statedType, std::string const& data)
@@ -376,6 +426,7 @@ namespace LightningJSON
 		::new(m_holder) Holder(statedType);
 		m_holder->m_data = StringData(data.data(), data.length());
 		m_holder->m_data.CommitStorage();
+		m_holder->DetectEscapes();
 	}
 
 	inline JSONObject::JSONObject(JSONType statedType, std::string_view const& data)
@@ -385,6 +436,7 @@ namespace LightningJSON
 		::new(m_holder) Holder(statedType);
 		m_holder->m_data = StringData(data.data(), data.length());
 		m_holder->m_data.CommitStorage();
+		m_holder->DetectEscapes();
 	}
 
 	inline JSONObject::JSONObject(JSONType statedType, bool data)
@@ -400,6 +452,7 @@ namespace LightningJSON
 		{
 			m_holder->m_data = StringData("false", 5);
 		}
+		m_holder->SetConverted(data ? 1 : 0);
 	}
 
 	inline JSONObject::JSONObject(JSONType statedType)
@@ -414,10 +467,8 @@ namespace LightningJSON
 		, m_key(nullptr, 0)
 	{
 		::new(m_holder) Holder(statedType);
-		char buf[128];
-		snprintf(buf, 128, "%lld", data);
-		m_holder->m_data = StringData(buf, strlen(buf));
-		m_holder->m_data.CommitStorage();
+		m_holder->SetInlineText(detail_::FormatInteger(data, m_holder->m_children.asScalar.text));
+		m_holder->SetConverted(uint64_t(data));
 	}
 
 	inline JSONObject::JSONObject(JSONType statedType, unsigned long long data)
@@ -425,10 +476,12 @@ namespace LightningJSON
 		, m_key(nullptr, 0)
 	{
 		::new(m_holder) Holder(statedType);
-		char buf[128];
-		snprintf(buf, 128, "%llu", data);
-		m_holder->m_data = StringData(buf, strlen(buf));
-		m_holder->m_data.CommitStorage();
+		m_holder->SetInlineText(detail_::FormatUnsigned(data, m_holder->m_children.asScalar.text));
+		m_holder->SetConverted(uint64_t(data));
+		if (data > (unsigned long long)(INT64_MAX))
+		{
+			m_holder->m_numberClass = detail_::NumberClass::UInt64;
+		}
 	}
 
 	inline JSONObject::JSONObject(JSONType statedType, long double data)
@@ -436,10 +489,11 @@ namespace LightningJSON
 		, m_key(nullptr, 0)
 	{
 		::new(m_holder) Holder(statedType);
-		char buf[128];
-		snprintf(buf, 128, "%.20Lg", data);
-		m_holder->m_data = StringData(buf, strlen(buf));
-		m_holder->m_data.CommitStorage();
+		double const value = double(data);
+		m_holder->SetInlineText(detail_::FormatDouble(value, m_holder->m_children.asScalar.text));
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		m_holder->SetConverted(bits);
 	}
 
 	inline JSONObject::JSONObject(StringData const& myKey, JSONType statedType, std::string const& data)
@@ -450,6 +504,7 @@ namespace LightningJSON
 		m_key.CommitStorage();
 		m_holder->m_data = StringData(data.data(), data.length());
 		m_holder->m_data.CommitStorage();
+		m_holder->DetectEscapes();
 	}
 
 	inline JSONObject::JSONObject(StringData const& myKey, JSONType statedType, std::string_view const& data)
@@ -460,6 +515,7 @@ namespace LightningJSON
 		m_key.CommitStorage();
 		m_holder->m_data = StringData(data.data(), data.length());
 		m_holder->m_data.CommitStorage();
+		m_holder->DetectEscapes();
 	}
 
 	inline JSONObject::JSONObject(StringData const& myKey, JSONType statedType, bool data)
@@ -476,6 +532,7 @@ namespace LightningJSON
 		{
 			m_holder->m_data = StringData("false", 5);
 		}
+		m_holder->SetConverted(data ? 1 : 0);
 	}
 
 	inline JSONObject::JSONObject(StringData const& myKey, JSONType statedType)
@@ -492,10 +549,8 @@ namespace LightningJSON
 	{
 		::new(m_holder) Holder(statedType);
 		m_key.CommitStorage();
-		char buf[128];
-		snprintf(buf, 128, "%lld", data);
-		m_holder->m_data = StringData(buf, strlen(buf));
-		m_holder->m_data.CommitStorage();
+		m_holder->SetInlineText(detail_::FormatInteger(data, m_holder->m_children.asScalar.text));
+		m_holder->SetConverted(uint64_t(data));
 	}
 
 	inline JSONObject::JSONObject(StringData const& myKey, JSONType statedType, unsigned long long data)
@@ -504,10 +559,12 @@ namespace LightningJSON
 	{
 		::new(m_holder) Holder(statedType);
 		m_key.CommitStorage();
-		char buf[128];
-		snprintf(buf, 128, "%llu", data);
-		m_holder->m_data = StringData(buf, strlen(buf));
-		m_holder->m_data.CommitStorage();
+		m_holder->SetInlineText(detail_::FormatUnsigned(data, m_holder->m_children.asScalar.text));
+		m_holder->SetConverted(uint64_t(data));
+		if (data > (unsigned long long)(INT64_MAX))
+		{
+			m_holder->m_numberClass = detail_::NumberClass::UInt64;
+		}
 	}
 
 	inline JSONObject::JSONObject(StringData const& myKey, JSONType statedType, long double data)
@@ -516,27 +573,30 @@ namespace LightningJSON
 	{
 		::new(m_holder) Holder(statedType);
 		m_key.CommitStorage();
-		char buf[128];
-		snprintf(buf, 128, "%.20Lg", data);
-		m_holder->m_data = StringData(buf, strlen(buf));
-		m_holder->m_data.CommitStorage();
+		double const value = double(data);
+		m_holder->SetInlineText(detail_::FormatDouble(value, m_holder->m_children.asScalar.text));
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		m_holder->SetConverted(bits);
 	}
 
-	inline void JSONObject::BuildJSONString(std::stringstream& outString, bool pretty, int tabDepth)
+	template<typename t_Output>
+	inline void JSONObject::BuildJSONString(t_Output& out, bool pretty, int tabDepth)
 	{
+		EnsureParsed();
 		if (m_holder->m_type == JSONType::Object)
 		{
-			outString << '{';
+			out.Append('{');
 			if (pretty)
 			{
-				outString << '\n';
+				out.Append('\n');
 			}
 			else
 			{
-				outString << ' ';
+				out.Append(' ');
 			}
 			bool first = true;
-			for (auto kvp : m_holder->m_children.asObject)
+			for (auto& kvp : m_holder->m_children.asObject)
 			{
 				if (kvp.value.IsEmpty())
 				{
@@ -545,56 +605,50 @@ namespace LightningJSON
 
 				if (!first)
 				{
-					outString << ',';
+					out.Append(',');
 					if (pretty)
 					{
-						outString << '\n';
+						out.Append('\n');
 					}
 					else
 					{
-						outString << ' ';
+						out.Append(' ');
 					}
 				}
 
 				if (pretty)
 				{
-					for (int i = 0; i < tabDepth; ++i)
-					{
-						outString << '\t';
-					}
+					out.Append('\t', size_t(tabDepth));
 				}
-				outString << '"';
-				outString << std::string_view(kvp.key.c_str(), kvp.key.length());
-				outString << "\" : ";
-				kvp.value.BuildJSONString(outString, pretty, tabDepth + 1);
+				out.Append('"');
+				out.Append(kvp.key.c_str(), kvp.key.length());
+				out.Append("\" : ");
+				kvp.value.BuildJSONString(out, pretty, tabDepth + 1);
 				first = false;
 			}
 			if (pretty)
 			{
-				outString << '\n';
+				out.Append('\n');
 
-				for (int i = 0; i < tabDepth - 1; ++i)
-				{
-					outString << '\t';
-				}
+				out.Append('\t', size_t(tabDepth - 1));
 			}
 			else
 			{
-				outString << ' ';
+				out.Append(' ');
 			}
 
-			outString << '}';
+			out.Append('}');
 		}
 		else if (m_holder->m_type == JSONType::Array)
 		{
-			outString << '[';
+			out.Append('[');
 			if (pretty)
 			{
-				outString << '\n';
+				out.Append('\n');
 			}
 			else
 			{
-				outString << ' ';
+				out.Append(' ');
 			}
 			bool first = true;
 			for (auto& it : m_holder->m_children.asArray)
@@ -605,98 +659,199 @@ namespace LightningJSON
 				}
 				if (!first)
 				{
-					outString << ',';
+					out.Append(',');
 					if (pretty)
 					{
-						outString << '\n';
+						out.Append('\n');
 					}
 					else
 					{
-						outString << ' ';
+						out.Append(' ');
 					}
 				}
 
 				if (pretty)
 				{
-					for (int i = 0; i < tabDepth; ++i)
-					{
-						outString << '\t';
-					}
+					out.Append('\t', size_t(tabDepth));
 				}
-				it.BuildJSONString(outString, pretty, tabDepth + 1);
+				it.BuildJSONString(out, pretty, tabDepth + 1);
 				first = false;
 			}
 			if (pretty)
 			{
-				outString << '\n';
+				out.Append('\n');
 
-				for (int i = 0; i < tabDepth - 1; ++i)
-				{
-					outString << '\t';
-				}
+				out.Append('\t', size_t(tabDepth - 1));
 			}
 			else
 			{
-				outString << ' ';
+				out.Append(' ');
 			}
 
-			outString << ']';
+			out.Append(']');
 		}
 		else if (m_holder->m_type == JSONType::Null)
 		{
-			outString << "null";
+			out.Append("null");
 		}
 		else if (m_holder->m_type == JSONType::String)
 		{
-			outString << '"';
-			outString << EscapeString(m_holder->m_data);
-			outString << '"';
+			out.Append('"');
+			EscapeInto(out, m_holder->m_data);
+			out.Append('"');
 		}
 		else
 		{
-			outString << std::string_view(m_holder->m_data.c_str(), m_holder->m_data.length());
+			out.Append(m_holder->m_data.c_str(), m_holder->m_data.length());
 		}
 	}
 
-	inline void JSONObject::SkipWhitespace(char const*& data)
+	inline size_t JSONObject::MeasureJSONString(bool pretty, int tabDepth)
 	{
-		while (*data == ' ' || *data == '\t' || *data == '\n' || *data == '\r')
-			++data;
+		EnsureParsed();
+		bool const isObject = m_holder->m_type == JSONType::Object;
+		if (isObject || m_holder->m_type == JSONType::Array)
+		{
+			// The brackets, the space or newline after the opening one, and the space or newline
+			// (and indentation) before the closing one.
+			size_t length = pretty ? 4 + size_t(tabDepth - 1) : 4;
+			size_t count = 0;
+			auto measure = [&](JSONObject& value)
+			{
+				if (count != 0)
+				{
+					length += 2;
+				}
+				if (pretty)
+				{
+					length += size_t(tabDepth);
+				}
+				length += value.MeasureJSONString(pretty, tabDepth + 1);
+				++count;
+			};
+
+			if (isObject)
+			{
+				for (auto& kvp : m_holder->m_children.asObject)
+				{
+					if (kvp.value.IsEmpty())
+					{
+						continue;
+					}
+					// The quoted key and the " : " after it.
+					length += kvp.key.length() + 5;
+					measure(kvp.value);
+				}
+			}
+			else
+			{
+				for (auto& it : m_holder->m_children.asArray)
+				{
+					if (!it.IsEmpty())
+					{
+						measure(it);
+					}
+				}
+			}
+			return length;
+		}
+		else if (m_holder->m_type == JSONType::Null)
+		{
+			return 4;
+		}
+		else if (m_holder->m_type == JSONType::String)
+		{
+			return EscapedLength(m_holder->m_data) + 2;
+		}
+		return m_holder->m_data.length();
+	}
+
+	inline void JSONObject::SkipWhitespace(char const*& data, char const* end)
+	{
+		// Compact JSON has at most one space between tokens, so only pay for a vector load
+		// once a longer run (usually indentation) shows up.
+		if (data >= end || !detail_::IsWhitespace(*data))
+		{
+			return;
+		}
+		++data;
+		if (data == end || !detail_::IsWhitespace(*data))
+		{
+			return;
+		}
+		data = detail_::FindNonWhitespace(data + 1, end);
 	}
 
-	inline void JSONObject::CollectString(char const*& data)
+	inline bool JSONObject::CollectString(char const*& data, char const* end)
 	{
+		bool hasEscapes = false;
+		++data;
 		for (;;)
 		{
-			++data;
-			switch (*data)
+			data = detail_::FindStringToken(data, end);
+			if (data == end)
+			{
+				// Reached the end of the input before the string was closed.
+				throw InvalidJSON();
+			}
+			if (*data == '\"')
 			{
-			case '\"':
-				++data;
-				return;
-			case '\\':
 				++data;
-				break;
+				return hasEscapes;
+			}
+			if (end - data < 2)
+			{
+				throw InvalidJSON();
 			}
+			// Step over the backslash and the character it escapes.
+			hasEscapes = true;
+			data += 2;
 		}
 	}
 
-	inline void JSONObject::ParseString(char const*& data)
+	inline void JSONObject::ParseString(char const*& data, char const* end, bool inSitu)
 	{
 		char const* startPoint = data + 1;
 
-		CollectString(data);
+		m_holder->m_hasEscapes = CollectString(data, end);
 
-		m_holder->m_data = StringData(startPoint, data - startPoint - 1);
+		size_t length = data - startPoint - 1;
+		if (inSitu && m_holder->m_hasEscapes)
+		{
+			// The caller handed over a writable buffer, so casting away const is safe.
+			length = Unescape(startPoint, length, const_cast<char*>(startPoint));
+			m_holder->m_hasEscapes = false;
+		}
+		m_holder->m_data = StringData(startPoint, length);
 	}
 
-	inline void JSONObject::ParseNumber(char const*& data)
+	inline void JSONObject::ParseNumber(char const*& data, char const* end)
 	{
 		char const* startPoint = data;
+		m_holder->m_type = ScanNumber(data, end, m_holder->m_numberClass);
+		m_holder->m_data = StringData(startPoint, data - startPoint);
+	}
+
+	inline JSONType JSONObject::ScanNumber(char const*& data, char const* end, detail_::NumberClass& numberClass)
+	{
+		char const* const startPoint = data;
+		if (detail_::ScanNumber(data, end, numberClass))
+		{
+			return numberClass == detail_::NumberClass::Double ? JSONType::Double : JSONType::Integer;
+		}
+
+#if LIGHTNINGJSON_STRICT
+		(void)startPoint;
+		throw InvalidJSON();
+#else
+		// Not a valid number; take every character that could belong to one, as before.
+		data = startPoint;
+		JSONType type = JSONType::Integer;
+		numberClass = detail_::NumberClass::Int64;
 
 		for(;;)
 		{
-			switch (*data)
+			switch (Peek(data, end))
 			{
 			case '-':
 			case '+':
@@ -718,48 +873,45 @@ namespace LightningJSON
 			case 'e':
 			case 'E':
 			{
-				if (m_holder->m_type == JSONType::Integer)
-				{
-					m_holder->m_type = JSONType::Double;
-				}
+				type = JSONType::Double;
+				numberClass = detail_::NumberClass::Double;
 				++data;
 				break;
 			}
 			default:
 			{
-				m_holder->m_data = StringData(startPoint, data - startPoint);
-				return;
+				return type;
 			}
 			}
 		}
+#endif
 	}
 
-	inline void JSONObject::ParseBool(char const*& data)
+	inline void JSONObject::SkipLiteral(char const*& data, char const* end, std::string_view const& literal)
 	{
-		if (
-			*data == 't'
-#if LIGHTNINGJSON_STRICT
-			&& *(data + 1) == 'r'
-			&& *(data + 2) == 'u'
-			&& *(data + 3) == 'e'
-#endif
-			)
+		if (size_t(end - data) < literal.length())
 		{
-			m_holder->m_data = StringData(data, 4);
-			data += 4;
+			throw InvalidJSON();
 		}
-		else if (
-			*data == 'f'
 #if LIGHTNINGJSON_STRICT
-			&& *(data + 1) == 'a'
-			&& *(data + 2) == 'l'
-			&& *(data + 3) == 's'
-			&& *(data + 4) == 'e'
+		if (memcmp(data + 1, literal.data() + 1, literal.length() - 1) != 0)
+		{
+			throw InvalidJSON();
+		}
 #endif
-			)
+		data += literal.length();
+	}
+
+	inline void JSONObject::ParseBool(char const*& data, char const* end)
+	{
+		char const* const startPoint = data;
+		if (Peek(data, end) == 't')
 		{
-			m_holder->m_data = StringData(data, 5);
-			data += 5;
+			SkipLiteral(data, end, "true");
+		}
+		else if (Peek(data, end) == 'f')
+		{
+			SkipLiteral(data, end, "false");
 		}
 #if LIGHTNINGJSON_STRICT
 		else
@@ -767,31 +919,152 @@ namespace LightningJSON
 			throw InvalidJSON();
 		}
 #endif
-		return;
+		m_holder->m_data = StringData(startPoint, data - startPoint);
+	}
+
+	template<typename... t_Args>
+	inline void JSONObject::AddChild(Holder* container, StringData const& key, t_Args&&... args)
+	{
+		if (container->m_type == JSONType::Array)
+		{
+			container->m_children.asArray.emplace_back(std::forward<t_Args>(args)...);
+		}
+		else
+		{
+			container->m_children.asObject.Insert(key, JSONObject(std::forward<t_Args>(args)...));
+		}
 	}
 
-	inline void JSONObject::ParseArray(char const*& data)
+	inline void JSONObject::ParseContainer(char const*& data, char const* end, ParseMode mode, JSONProjection::Node const* filter)
 	{
+		struct Frame
+		{
+			Holder* holder;
+			JSONProjection::Node const* filter;
+			size_t index;
+		};
+
+		// Reused from one parse to the next; nothing called from here parses a container in turn.
+		static thread_local std::vector<Frame> stack;
+		stack.clear();
+		stack.reserve(64);
+		stack.push_back(Frame{ m_holder, filter, 0 });
+
+		ParseMode const childMode = mode == ParseMode::Lazy ? ParseMode::Deferred : ParseMode::Eager;
+		ParseMode const stringMode = mode == ParseMode::InSitu ? ParseMode::InSitu : ParseMode::Eager;
+		bool afterValue = false;
 		++data;
 
 		for (;;)
 		{
-			SkipWhitespace(data);
-			if (*data == ']')
+			Frame& top = stack.back();
+			Holder* const holder = top.holder;
+			bool const isArray = holder->m_type == JSONType::Array;
+			char const close = isArray ? ']' : '}';
+
+			if (afterValue)
+			{
+				SkipWhitespace(data, end);
+				// Whatever the mode, the input must not end before the container does.
+				if (data >= end)
+				{
+					throw InvalidJSON();
+				}
+
+#if LIGHTNINGJSON_STRICT
+				if (*data != ',' && *data != close)
+				{
+					throw InvalidJSON();
+				}
+#endif
+
+				if (*data != close)
+				{
+					++data;
+				}
+			}
+
+			SkipWhitespace(data, end);
+			if (data >= end)
+			{
+				throw InvalidJSON();
+			}
+			if (*data == close)
 			{
 				++data;
-				return;
+				stack.pop_back();
+				if (stack.empty())
+				{
+					return;
+				}
+				afterValue = true;
+				continue;
 			}
-			switch (*data)
+			afterValue = true;
+
+			StringData key(nullptr, 0);
+			if (!isArray)
 			{
-			case '{':
+#if LIGHTNINGJSON_STRICT
+				if (*data != '\"')
+				{
+					throw InvalidJSON();
+				}
+#endif
+
+				char const* const keyStart = data + 1;
+				CollectString(data, end);
+				key = StringData(keyStart, data - 1 - keyStart);
+
+				SkipWhitespace(data, end);
+
+#if LIGHTNINGJSON_STRICT
+				if (Peek(data, end) != ':')
+				{
+					throw InvalidJSON();
+				}
+#endif
+
+				++data;
+				SkipWhitespace(data, end);
+				if (data >= end)
+				{
+					throw InvalidJSON();
+				}
+			}
+
+			JSONProjection::Node const* childFilter = nullptr;
+			if (top.filter && !SelectChild(isArray ? top.filter->FindIndex(top.index) : top.filter->Find(key.toStringView()), *data, childFilter))
 			{
-				m_holder->m_children.asArray.emplace_back(StringData(nullptr, 0), data, JSONType::Object);
-				break;
+				++top.index;
+				SkipValue(data, end);
+				continue;
 			}
+			++top.index;
+
+			switch (*data)
+			{
+			case '{':
 			case '[':
 			{
-				m_holder->m_children.asArray.emplace_back(StringData(nullptr, 0), data, JSONType::Array);
+				JSONType const type = *data == '{' ? JSONType::Object : JSONType::Array;
+				if (childMode == ParseMode::Deferred)
+				{
+					AddChild(holder, key, key, data, end, type, ParseMode::Deferred);
+					break;
+				}
+
+				if (stack.size() >= LIGHTNINGJSON_MAX_DEPTH)
+				{
+					throw DepthLimitExceeded();
+				}
+				JSONObject child(type);
+				child.m_key = key;
+				AddChild(holder, key, child);
+				++data;
+				// May reallocate the stack, so top is not used after this.
+				stack.push_back(Frame{ child.m_holder, childFilter, 0 });
+				afterValue = false;
 				break;
 			}
 			case '+':
@@ -808,24 +1081,24 @@ namespace LightningJSON
 			case '9':
 			case '.':
 			{
-				m_holder->m_children.asArray.emplace_back(StringData(nullptr, 0), data, JSONType::Integer);
+				AddChild(holder, key, key, data, end, JSONType::Integer, ParseMode::Eager);
 				break;
 			}
 			case '\"':
 			{
-				m_holder->m_children.asArray.emplace_back(StringData(nullptr, 0), data, JSONType::String);
+				AddChild(holder, key, key, data, end, JSONType::String, stringMode);
 				break;
 			}
 			case 't':
 			case 'f':
 			{
-				m_holder->m_children.asArray.emplace_back(StringData(nullptr, 0), data, JSONType::Boolean);
+				AddChild(holder, key, key, data, end, JSONType::Boolean, ParseMode::Eager);
 				break;
 			}
 			case 'n':
 			{
-				m_holder->m_children.asArray.emplace_back(JSONType::Null);
-				data += 4;
+				SkipLiteral(data, end, "null");
+				AddChild(holder, key, JSONType::Null);
 				break;
 			}
 #if LIGHTNINGJSON_STRICT
@@ -835,162 +1108,644 @@ namespace LightningJSON
 			}
 #endif
 			}
+		}
+	}
 
-			SkipWhitespace(data);
+	inline JSONObject::JSONObject(StringData const& myKey, char const*& data, char const* end, JSONType expectedType, ParseMode mode, JSONProjection::Node const* filter)
+		: JSONObject(Holder::Create(), myKey, data, end, expectedType, mode, filter)
+	{
+		//
+	}
 
-#if LIGHTNINGJSON_STRICT
-			if (*data != ',' && *data != ']')
+	inline JSONObject::JSONObject(Holder* holder, StringData const& myKey, char const*& data, char const* end, JSONType expectedType, ParseMode mode, JSONProjection::Node const* filter)
+		: m_holder(holder)
+		, m_key(myKey)
+	{
+		bool const deferred = mode == ParseMode::Deferred && (expectedType == JSONType::Array || expectedType == JSONType::Object);
+		::new(m_holder) Holder(expectedType, deferred);
+		try
+		{
+			if (deferred)
 			{
-				throw InvalidJSON();
+				char const* startPoint = data;
+				SkipContainer(data, end);
+				m_holder->m_data = StringData(startPoint, data - startPoint);
+				return;
 			}
-#endif
 
-			if (*data == ']')
+			switch (expectedType)
 			{
-				++data;
+			case JSONType::Boolean: ParseBool(data, end); break;
+			case JSONType::Integer: ParseNumber(data, end); break;
+			case JSONType::String: ParseString(data, end, mode == ParseMode::InSitu); break;
+			case JSONType::Array:
+			case JSONType::Object:
+				ParseContainer(data, end, mode, filter);
 				break;
+				// "Empty" and "Null" have no content to parse.
+				// "Double" will never actually show up here - it will begin its life as "Integer" and grow into "Double" later!
+			case JSONType::Empty: case JSONType::Double: case JSONType::Null: default: break;
 			}
-			++data;
+		}
+		catch (...)
+		{
+			// The destructor will not run, so free the holder along with everything already built under it.
+			Holder::Free(m_holder);
+			throw;
+		}
+	}
+
+	inline JSONType JSONObject::TypeOfValue(char c)
+	{
+		switch (c)
+		{
+		case '{': return JSONType::Object;
+		case '[': return JSONType::Array;
+		case '"': return JSONType::String;
+		case 't':
+		case 'f': return JSONType::Boolean;
+		case 'n': return JSONType::Null;
+		case '+':
+		case '-':
+		case '0':
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9':
+		case '.':
+			return JSONType::Integer;
+		default:
+			throw InvalidJSON();
 		}
 	}
 
-	inline void JSONObject::ParseObject(char const*& data)
+	inline JSONObject JSONObject::FromString(std::string_view const& jsonStr, JSONProjection const& projection)
 	{
-		++data;
+		if (!jsonStr.data() || jsonStr.length() == 0)
+		{
+			return GetEmpty();
+		}
 
-		StringData key(nullptr, 0);
+		ValidateEncoding(jsonStr);
+		char const* data = jsonStr.data();
+		char const* const end = data + jsonStr.length();
+		SkipWhitespace(data, end);
+		JSONProjection::Node const* filter = projection.Root()->IncludesAll() ? nullptr : projection.Root();
+		return JSONObject(StringData(nullptr, 0), data, end, TypeOfValue(Peek(data, end)), ParseMode::Eager, filter);
+	}
 
-		for (;;)
+	inline bool JSONObject::SelectChild(JSONProjection::Node const* match, char first, JSONProjection::Node const*& childFilter)
+	{
+		if (!match)
 		{
-			SkipWhitespace(data);
-
-			if (*data == '}')
-			{
-				++data;
-				return;
-			}
+			return false;
+		}
+		if (match->IncludesAll())
+		{
+			childFilter = nullptr;
+			return true;
+		}
+		// The path continues below this child, which is only possible if it is a container.
+		childFilter = match;
+		return first == '{' || first == '[';
+	}
 
-#if LIGHTNINGJSON_STRICT
-			if (*data != '\"')
-			{
-				throw InvalidJSON();
-			}
-#endif
+	inline JSONObject JSONObject::ParseElement(char const*& data, char const* end)
+	{
+		if (*data == 'n')
+		{
+			SkipLiteral(data, end, "null");
+			return JSONObject(JSONType::Null);
+		}
+		return JSONObject(StringData(nullptr, 0), data, end, TypeOfValue(*data), ParseMode::Eager);
+	}
 
-			char const* keyStart = nullptr;
-			char const* keyEnd = nullptr;
+	inline JSONObject JSONObject::FromStringParallel(std::string_view const& jsonStr, ThreadPool& pool)
+	{
+		// Below this, the threads cost more than they save.
+		static constexpr size_t minSpanSize = 64 * 1024;
 
-			keyStart = data + 1;
+		if (!jsonStr.data() || jsonStr.length() == 0)
+		{
+			return GetEmpty();
+		}
 
-			CollectString(data);
+		char const* data = jsonStr.data();
+		char const* const end = data + jsonStr.length();
+		SkipWhitespace(data, end);
+		if (Peek(data, end) != '[' || jsonStr.length() < 2 * minSpanSize || pool.ThreadCount() < 2)
+		{
+			return FromString(jsonStr);
+		}
 
-			keyEnd = data - 1;
-			key = StringData(keyStart, keyEnd - keyStart);
+		ValidateEncoding(jsonStr);
 
-			SkipWhitespace(data);
+		// Skim the elements (without building anything) to cut the array into spans of whole
+		// elements. Each span runs from its first element to the separator after its last one.
+		size_t spanSize = jsonStr.length() / (pool.ThreadCount() * 8);
+		if (spanSize < minSpanSize)
+		{
+			spanSize = minSpanSize;
+		}
 
-#if LIGHTNINGJSON_STRICT
-			if (*data != ':')
+		std::vector<std::pair<char const*, char const*>> spans;
+		++data;
+		SkipWhitespace(data, end);
+		char const* spanStart = data;
+		while (Peek(data, end) != ']')
+		{
+			SkipValue(data, end);
+			SkipWhitespace(data, end);
+			if (Peek(data, end) != ',' && Peek(data, end) != ']')
 			{
 				throw InvalidJSON();
 			}
-#endif
-
-			++data;
-
-			SkipWhitespace(data);
-
-			switch (*data)
+			if (size_t(data - spanStart) >= spanSize || *data == ']')
 			{
-			case '{':
+				spans.emplace_back(spanStart, data);
+				spanStart = nullptr;
+			}
+			if (*data == ']')
 			{
-				m_holder->m_children.asObject.Insert(key, JSONObject(key, data, JSONType::Object));
 				break;
 			}
-			case '[':
+			++data;
+			SkipWhitespace(data, end);
+			if (!spanStart)
 			{
-				m_holder->m_children.asObject.Insert(key, JSONObject(key, data, JSONType::Array));
-				break;
+				spanStart = data;
 			}
-			case '-':
-			case '0':
-			case '1':
-			case '2':
-			case '3':
-			case '4':
-			case '5':
+		}
+		// A trailing comma leaves an empty span at the end.
+		if (spanStart && spanStart != data)
+		{
+			spans.emplace_back(spanStart, data);
+		}
+
+		std::vector<TokenList> results(spans.size());
+		pool.ParallelFor(spans.size(), [&](size_t index)
+		{
+			char const* pos = spans[index].first;
+			char const* const spanEnd = spans[index].second;
+			TokenList& list = results[index];
+			while (pos < spanEnd)
+			{
+				list.push_back(ParseElement(pos, spanEnd));
+				SkipWhitespace(pos, spanEnd);
+				++pos;
+				SkipWhitespace(pos, spanEnd);
+			}
+		});
+
+		size_t total = 0;
+		for (auto& list : results)
+		{
+			total += list.size();
+		}
+
+		// Splice the spans together by swapping holders into slots that all share one
+		// placeholder, so no element's reference count is touched and nothing is allocated.
+		JSONObject ret(JSONType::Array);
+		JSONObject const placeholder(JSONType::Empty);
+		TokenList& elements = ret.m_holder->m_children.asArray;
+		elements.resize(total, placeholder);
+		size_t index = 0;
+		for (auto& list : results)
+		{
+			for (auto& element : list)
+			{
+				std::swap(elements[index++].m_holder, element.m_holder);
+			}
+		}
+		return ret;
+	}
+
+	inline std::vector<JSONObject> JSONObject::ParseBatch(std::string_view const* documents, size_t const count, ThreadPool& pool)
+	{
+		// Small messages parse in a few microseconds, so hand them out in groups to keep the
+		// queueing cost down while leaving enough groups to balance the load.
+		size_t groupSize = count / (pool.ThreadCount() * 8);
+		if (groupSize == 0)
+		{
+			groupSize = 1;
+		}
+		size_t const groupCount = (count + groupSize - 1) / groupSize;
+
+		// Each group's objects are built on the worker that parses it and only swapped into the
+		// results here, once the workers are done. An empty document gets its own Empty object:
+		// FromString would return the shared one, whose reference count the workers would then
+		// update at once.
+		std::vector<std::vector<JSONObject>> groups(groupCount);
+		pool.ParallelFor(groupCount, [&](size_t group)
+		{
+			size_t const begin = group * groupSize;
+			size_t const end = begin + groupSize < count ? begin + groupSize : count;
+			std::vector<JSONObject>& objects = groups[group];
+			objects.reserve(end - begin);
+			for (size_t i = begin; i < end; ++i)
+			{
+				if (!documents[i].data() || documents[i].length() == 0)
+				{
+					objects.push_back(JSONObject(JSONType::Empty));
+				}
+				else
+				{
+					objects.push_back(FromString(documents[i]));
+				}
+			}
+		});
+
+		// As in FromStringParallel, swap the holders into slots sharing one placeholder.
+		JSONObject const placeholder(JSONType::Empty);
+		std::vector<JSONObject> results(count, placeholder);
+		size_t index = 0;
+		for (auto& objects : groups)
+		{
+			for (auto& object : objects)
+			{
+				std::swap(results[index++].m_holder, object.m_holder);
+			}
+		}
+		return results;
+	}
+
+	inline JSONObject JSONObject::FromFile(char const* path)
+	{
+		detail_::SourceBuffer* source = detail_::SourceBuffer::Open(path);
+		source->AddRef();
+		if (source->Size() == 0)
+		{
+			source->Release();
+			return GetEmpty();
+		}
+
+		try
+		{
+			ValidateEncoding(std::string_view(source->Data(), source->Size()));
+			char const* data = source->Data();
+			char const* const end = data + source->Size();
+			SkipWhitespace(data, end);
+			JSONType const type = TypeOfValue(Peek(data, end));
+
+			source->AdviseSequential(true);
+			JSONObject ret(Holder::CreateWithSource(source), StringData(nullptr, 0), data, end, type, ParseMode::Eager);
+			source->AdviseSequential(false);
+			// The root takes over the reference added above.
+			ret.m_holder->m_ownsSource = true;
+			return ret;
+		}
+		catch (...)
+		{
+			source->Release();
+			throw;
+		}
+	}
+
+	inline JSONObject JSONObject::FromStringLazy(std::string_view const& jsonStr)
+	{
+		if (!jsonStr.data() || jsonStr.length() == 0)
+		{
+			return GetEmpty();
+		}
+
+		ValidateEncoding(jsonStr);
+		char const* data = jsonStr.data();
+		char const* const end = data + jsonStr.length();
+		SkipWhitespace(data, end);
+		switch (Peek(data, end))
+		{
+		case '{': return JSONObject(StringData(nullptr, 0), data, end, JSONType::Object, ParseMode::Lazy);
+		case '[': return JSONObject(StringData(nullptr, 0), data, end, JSONType::Array, ParseMode::Lazy);
+		default: return FromString(jsonStr);
+		}
+	}
+
+	inline void JSONObject::ParseDeferred() const
+	{
+		Holder* holder = m_holder;
+		char const* data = holder->m_data.c_str();
+		char const* const end = data + holder->m_data.length();
+
+		holder->m_deferred = false;
+		holder->m_data = StringData(nullptr, 0);
+		holder->InitChildren();
+
+		// Children of a deferred container are deferred in turn, so each access only pays for one level.
+		const_cast<JSONObject*>(this)->ParseContainer(data, end, ParseMode::Lazy, nullptr);
+	}
+
+	inline void JSONObject::SkipContainer(char const*& data, char const* end)
+	{
+		size_t depth = 0;
+		for (;;)
+		{
+			data = detail_::FindContainerToken(data, end);
+			switch (Peek(data, end))
+			{
+			case '{':
+			case '[':
+				++depth;
+				++data;
+				break;
+			case '}':
+			case ']':
+				++data;
+				if (--depth == 0)
+				{
+					return;
+				}
+				break;
+			case '\"':
+				CollectString(data, end);
+				break;
+			default:
+				// Reached the end of the input before the container was closed.
+				throw InvalidJSON();
+			}
+		}
+	}
+
+	inline void JSONObject::SkipValue(char const*& data, char const* end)
+	{
+		switch (Peek(data, end))
+		{
+		case '{':
+		case '[':
+			SkipContainer(data, end);
+			break;
+		case '\"':
+			CollectString(data, end);
+			break;
+		default:
+			while (data < end && *data != ',' && *data != '}' && *data != ']' && *data != '\0' && !detail_::IsWhitespace(*data))
+			{
+				++data;
+			}
+			break;
+		}
+	}
+
+	inline JSONObject JSONObject::FromStringIndexed(std::string_view const& jsonStr)
+	{
+		if (!jsonStr.data() || jsonStr.length() == 0)
+		{
+			return GetEmpty();
+		}
+
+		// The index stores 32-bit offsets.
+		if (jsonStr.length() > UINT32_MAX)
+		{
+			return FromString(jsonStr);
+		}
+
+		ValidateEncoding(jsonStr);
+		StructuralIndex index;
+		index.Build(jsonStr.data(), jsonStr.length());
+		StructuralIndex::Cursor cursor = index.GetCursor();
+		JSONObject ret(StringData(nullptr, 0), cursor, 0, TypeOfValue(cursor.Peek()));
+
+#if LIGHTNINGJSON_STRICT
+		if (!cursor.AtEnd())
+		{
+			throw InvalidJSON();
+		}
+#endif
+
+		return ret;
+	}
+
+	inline JSONObject::JSONObject(StringData const& myKey, StructuralIndex::Cursor& cursor, size_t depth, JSONType expectedType)
+		: m_holder(Holder::Create())
+		, m_key(myKey)
+	{
+		::new(m_holder) Holder(expectedType);
+		try
+		{
+			switch (expectedType)
+			{
+			case JSONType::Boolean:
+			{
+				char const* data = cursor.Pointer();
+				ParseBool(data, cursor.InputEnd());
+				cursor.Advance();
+				break;
+			}
+			case JSONType::Integer:
+			{
+				char const* data = cursor.Pointer();
+				ParseNumber(data, cursor.InputEnd());
+				cursor.Advance();
+				break;
+			}
+			case JSONType::String:
+			{
+				// The index guarantees the next entry is the matching closing quote.
+				char const* startPoint = cursor.Pointer() + 1;
+				cursor.Advance();
+				m_holder->m_data = StringData(startPoint, cursor.Pointer() - startPoint);
+				m_holder->DetectEscapes();
+				cursor.Advance();
+				break;
+			}
+			case JSONType::Null:
+			{
+				char const* data = cursor.Pointer();
+				SkipLiteral(data, cursor.InputEnd(), "null");
+				cursor.Advance();
+				break;
+			}
+			case JSONType::Array: ParseIndexedArray(cursor, depth); break;
+			case JSONType::Object: ParseIndexedObject(cursor, depth); break;
+			case JSONType::Empty: case JSONType::Double: default: break;
+			}
+		}
+		catch (...)
+		{
+			// As in the other parsing constructor, the destructor will not run.
+			Holder::Free(m_holder);
+			throw;
+		}
+	}
+
+	// Unlike ParseContainer, the indexed variants always validate separators:
+	// the cursor cannot be advanced blindly past the end of the index.
+	// They recurse, so depth (the number of enclosing containers) is checked against
+	// LIGHTNINGJSON_MAX_DEPTH, as ParseContainer checks the size of its stack.
+	inline void JSONObject::ParseIndexedArray(StructuralIndex::Cursor& cursor, size_t depth)
+	{
+		if (depth >= LIGHTNINGJSON_MAX_DEPTH)
+		{
+			throw DepthLimitExceeded();
+		}
+		cursor.Advance();
+
+		for (;;)
+		{
+			if (cursor.Peek() == ']')
+			{
+				cursor.Advance();
+				return;
+			}
+			switch (cursor.Peek())
+			{
+			case '{':
+			{
+				m_holder->m_children.asArray.emplace_back(StringData(nullptr, 0), cursor, depth + 1, JSONType::Object);
+				break;
+			}
+			case '[':
+			{
+				m_holder->m_children.asArray.emplace_back(StringData(nullptr, 0), cursor, depth + 1, JSONType::Array);
+				break;
+			}
+			case '+':
+			case '-':
+			case '0':
+			case '1':
+			case '2':
+			case '3':
+			case '4':
+			case '5':
 			case '6':
 			case '7':
 			case '8':
 			case '9':
+			case '.':
 			{
-				m_holder->m_children.asObject.Insert(key, JSONObject(key, data, JSONType::Integer));
+				m_holder->m_children.asArray.emplace_back(StringData(nullptr, 0), cursor, depth + 1, JSONType::Integer);
 				break;
 			}
 			case '\"':
 			{
-				m_holder->m_children.asObject.Insert(key, JSONObject(key, data, JSONType::String));
+				m_holder->m_children.asArray.emplace_back(StringData(nullptr, 0), cursor, depth + 1, JSONType::String);
 				break;
 			}
 			case 't':
 			case 'f':
 			{
-				m_holder->m_children.asObject.Insert(key, JSONObject(key, data, JSONType::Boolean));
+				m_holder->m_children.asArray.emplace_back(StringData(nullptr, 0), cursor, depth + 1, JSONType::Boolean);
 				break;
 			}
 			case 'n':
 			{
-				m_holder->m_children.asObject.Insert(key, JSONObject(JSONType::Null));
-#if LIGHTNINGJSON_STRICT
-				if (*(data + 1) != 'u' || *(data + 2) != 'l' || *(data + 3) != 'l')
-				{
-					throw InvalidJSON();
-				}
-#endif
-				data += 4;
+				m_holder->m_children.asArray.emplace_back(StringData(nullptr, 0), cursor, depth + 1, JSONType::Null);
 				break;
 			}
-#if LIGHTNINGJSON_STRICT
 			default:
 			{
 				throw InvalidJSON();
 			}
-#endif
 			}
 
-			SkipWhitespace(data);
-
-#if LIGHTNINGJSON_STRICT
-			if (*data != ',' && *data != '}')
+			if (cursor.Peek() == ']')
 			{
-				throw InvalidJSON();
+				cursor.Advance();
+				return;
 			}
-#endif
-
-			if (*data == '}')
+			if (cursor.Peek() != ',')
 			{
-				++data;
-				break;
+				throw InvalidJSON();
 			}
-			++data;
+			cursor.Advance();
 		}
 	}
 
-	inline JSONObject::JSONObject(StringData const& myKey, char const*& data, JSONType expectedType)
-		: m_holder(Holder::Create())
-		, m_key(myKey)
+	inline void JSONObject::ParseIndexedObject(StructuralIndex::Cursor& cursor, size_t depth)
 	{
-		::new(m_holder) Holder(expectedType);
-		switch (expectedType)
+		if (depth >= LIGHTNINGJSON_MAX_DEPTH)
 		{
-		case JSONType::Boolean: ParseBool(data); break;
-		case JSONType::Integer: ParseNumber(data); break;
-		case JSONType::String: ParseString(data); break;
-		case JSONType::Array: ParseArray(data); break;
-		case JSONType::Object: ParseObject(data); break;
-			// "Empty" and "Null" have no content to parse.
-			// "Double" will never actually show up here - it will begin its life as "Integer" and grow into "Double" later!
-		case JSONType::Empty: case JSONType::Double: case JSONType::Null: default: break;
+			throw DepthLimitExceeded();
+		}
+		cursor.Advance();
+
+		for (;;)
+		{
+			if (cursor.Peek() == '}')
+			{
+				cursor.Advance();
+				return;
+			}
+
+			if (cursor.Peek() != '\"')
+			{
+				throw InvalidJSON();
+			}
+
+			char const* keyStart = cursor.Pointer() + 1;
+			cursor.Advance();
+			StringData key(keyStart, cursor.Pointer() - keyStart);
+			cursor.Advance();
+
+			if (cursor.Peek() != ':')
+			{
+				throw InvalidJSON();
+			}
+			cursor.Advance();
+
+			switch (cursor.Peek())
+			{
+			case '{':
+			{
+				m_holder->m_children.asObject.Insert(key, JSONObject(key, cursor, depth + 1, JSONType::Object));
+				break;
+			}
+			case '[':
+			{
+				m_holder->m_children.asObject.Insert(key, JSONObject(key, cursor, depth + 1, JSONType::Array));
+				break;
+			}
+			case '-':
+			case '0':
+			case '1':
+			case '2':
+			case '3':
+			case '4':
+			case '5':
+			case '6':
+			case '7':
+			case '8':
+			case '9':
+			{
+				m_holder->m_children.asObject.Insert(key, JSONObject(key, cursor, depth + 1, JSONType::Integer));
+				break;
+			}
+			case '\"':
+			{
+				m_holder->m_children.asObject.Insert(key, JSONObject(key, cursor, depth + 1, JSONType::String));
+				break;
+			}
+			case 't':
+			case 'f':
+			{
+				m_holder->m_children.asObject.Insert(key, JSONObject(key, cursor, depth + 1, JSONType::Boolean));
+				break;
+			}
+			case 'n':
+			{
+				m_holder->m_children.asObject.Insert(key, JSONObject(key, cursor, depth + 1, JSONType::Null));
+				break;
+			}
+			default:
+			{
+				throw InvalidJSON();
+			}
+			}
+
+			if (cursor.Peek() == '}')
+			{
+				cursor.Advance();
+				return;
+			}
+			if (cursor.Peek() != ',')
+			{
+				throw InvalidJSON();
+			}
+			cursor.Advance();
 		}
 	}
 
@@ -1022,10 +1777,11 @@ namespace LightningJSON
 
 	inline JSONObject JSONObject::ShallowCopy()
 	{
+		EnsureParsed();
 		JSONObject ret(m_key, m_holder->m_type);
 		Holder* newHolder = ret.m_holder;
 		//We do not want to copy object children directly. They need cleanup work.
-		newHolder->m_data = m_holder->m_data;
+		newHolder->CopyScalar(m_holder);
 		if (newHolder->m_type == JSONType::Array)
 		{
 			newHolder->m_children.asArray = m_holder->m_children.asArray;
@@ -1042,10 +1798,11 @@ namespace LightningJSON
 
 	inline JSONObject JSONObject::DeepCopy()
 	{
+		EnsureParsed();
 		JSONObject ret(m_key, m_holder->m_type);
 		Holder* newHolder = ret.m_holder;
 		//We do not want to copy object children directly. They need cleanup work.
-		newHolder->m_data = m_holder->m_data;
+		newHolder->CopyScalar(m_holder);
 		if (newHolder->m_type == JSONType::Array)
 		{
 			for (size_t i = 0; i < m_holder->m_children.asArray.size(); ++i)
@@ -1073,6 +1830,7 @@ namespace LightningJSON
 
 	inline JSONObject::iterator JSONObject::begin()
 	{
+		EnsureParsed();
 		if (m_holder->m_type == JSONType::Array)
 		{
 			return iterator(m_holder->m_children.asArray.begin(), m_holder->m_children.asArray.begin(), m_holder->m_children.asArray.end());
@@ -1086,6 +1844,7 @@ namespace LightningJSON
 
 	inline JSONObject::iterator JSONObject::end()
 	{
+		EnsureParsed();
 		if (m_holder->m_type == JSONType::Array)
 		{
 			return iterator(m_holder->m_children.asArray.end(), m_holder->m_children.asArray.begin(), m_holder->m_children.asArray.end());
@@ -1110,6 +1869,7 @@ namespace LightningJSON
 
 	inline JSONObject::const_iterator JSONObject::cbegin() const
 	{
+		EnsureParsed();
 		if (m_holder->m_type == JSONType::Array)
 		{
 			return const_iterator(m_holder->m_children.asArray.begin(), m_holder->m_children.asArray.begin(), m_holder->m_children.asArray.end());
@@ -1123,6 +1883,7 @@ namespace LightningJSON
 
 	inline JSONObject::const_iterator JSONObject::cend() const
 	{
+		EnsureParsed();
 		if (m_holder->m_type == JSONType::Array)
 		{
 			return const_iterator(m_holder->m_children.asArray.end(), m_holder->m_children.asArray.begin(), m_holder->m_children.asArray.end());
@@ -1136,243 +1897,242 @@ namespace LightningJSON
 
 	inline long long JSONObject::ToInt(StringData const& str)
 	{
-		long long result = 0;
-		size_t index = 0;
-		bool negative = false;
-		char const* const data = str.c_str();
-		size_t const length = str.length();
+		return (long long)(ToUInt(str));
+	}
 
-		if (*data == '-')
+	inline unsigned long long JSONObject::ToUInt(StringData const& str)
+	{
+		char const* data = str.c_str();
+		char const* const end = data + str.length();
+		bool const negative = data < end && *data == '-';
+		if (negative)
 		{
-			negative = true;
-			++index;
+			++data;
 		}
-		for (; index < length; ++index)
+
+		// Accumulated unsigned so that the most negative value does not overflow.
+		uint64_t const magnitude = detail_::AccumulateDigits(data, end, 0);
+		return negative ? 0 - magnitude : magnitude;
+	}
+
+	inline long long JSONObject::ToIntChecked(StringData const& str, JSONType type)
+	{
+		uint64_t magnitude;
+		bool negative;
+		bool overflow;
+		if ((type != JSONType::Integer && type != JSONType::Double) || !detail_::ParseInteger(str.c_str(), str.c_str() + str.length(), magnitude, negative, overflow))
+		{
+			throw JSONTypeMismatch(JSONType::Integer, type);
+		}
+		if (overflow || magnitude > (negative ? uint64_t(INT64_MAX) + 1 : uint64_t(INT64_MAX)))
 		{
-			result *= 10;
-			result += ((int)(data[index]) - 48);
+			throw NumberOutOfRange();
 		}
+		return (long long)(negative ? 0 - magnitude : magnitude);
+	}
 
-		if (negative)
+	inline unsigned long long JSONObject::ToUIntChecked(StringData const& str, JSONType type)
+	{
+		uint64_t magnitude;
+		bool negative;
+		bool overflow;
+		if ((type != JSONType::Integer && type != JSONType::Double) || !detail_::ParseInteger(str.c_str(), str.c_str() + str.length(), magnitude, negative, overflow))
 		{
-			result *= -1;
+			throw JSONTypeMismatch(JSONType::Integer, type);
 		}
+		if (overflow || (negative && magnitude != 0))
+		{
+			throw NumberOutOfRange();
+		}
+		return magnitude;
+	}
 
-		return result;
+	inline long double JSONObject::ToDouble(StringData const& str)
+	{
+		return (long double)(ToNativeDouble(str));
 	}
 
-	inline unsigned long long JSONObject::ToUInt(StringData const& str)
+	inline double JSONObject::ToNativeDouble(StringData const& str)
 	{
-		unsigned long long result = 0;
-		size_t index = 0;
+		return detail_::ParseDouble(str.c_str(), str.c_str() + str.length());
+	}
 
+	inline bool JSONObject::ToBool(StringData const& str)
+	{
 		char const* const data = str.c_str();
 		size_t const length = str.length();
-
-		for (; index < length; ++index)
+		if (
+			length == 4 &&
+			data[0] == 't' &&
+			data[1] == 'r' &&
+			data[2] == 'u' &&
+			data[3] == 'e'
+			)
 		{
-			result *= 10;
-			result += ((int)(data[index]) - 48);
+			return true;
 		}
+		return false;
+	}
 
+	inline std::string JSONObject::EscapeString(StringData const& str)
+	{
+		std::string result;
+		detail_::OutputBuffer buffer(result);
+		EscapeInto(buffer, str);
+		buffer.Finish();
 		return result;
 	}
 
-	inline long double JSONObject::ToDouble(StringData const& str)
+	template<typename t_Output>
+	inline void JSONObject::EscapeInto(t_Output& out, StringData const& str)
 	{
-		long double result = 0;
-		size_t index = 0;
-		bool negative = false;
-		double fractionSize = 1.0;
-		bool inFraction = false;
-		char const* const data = str.c_str();
-		size_t const length = str.length();
-
-		bool exp = false;
-		double expVal = 0;
-		bool expNegative = false;
+		static char const hexDigits[] = "0123456789abcdef";
 
-		if (*data == '-')
-		{
-			negative = true;
-			++index;
-		}
-		for (; index < length; ++index)
+		char const* data = str.c_str();
+		char const* const end = data + str.length();
+		for (;;)
 		{
-			char c = data[index];
-			if (c == '.')
+			char const* const special = detail_::FindCharacterToEscape(data, end);
+			out.Append(data, size_t(special - data));
+			if (special == end)
 			{
-				inFraction = true;
-				continue;
+				return;
 			}
-			if (c == 'e' || c == 'E')
+
+			unsigned char const c = static_cast<unsigned char>(*special);
+			switch (c)
 			{
-				exp = true;
-				if (index != length - 1)
-				{
-					if (data[index + 1] == '-')
-					{
-						++index;
-						expNegative = true;
-					}
-					else if (data[index + 1] == '+')
-					{
-						++index;
-					}
-					continue;
-				}
-				continue;
-			}
-			if (exp)
+			case '\"': out.Append("\\\"", 2); break;
+			case '\\': out.Append("\\\\", 2); break;
+			case '\b': out.Append("\\b", 2); break;
+			case '\f': out.Append("\\f", 2); break;
+			case '\n': out.Append("\\n", 2); break;
+			case '\r': out.Append("\\r", 2); break;
+			case '\t': out.Append("\\t", 2); break;
+			default:
 			{
-				expVal *= 10;
-				expVal += ((int)(data[index]) - 48);
+				// Any other control character has no short form.
+				char* const write = out.Reserve(6);
+				memcpy(write, "\\u00", 4);
+				write[4] = hexDigits[c >> 4];
+				write[5] = hexDigits[c & 0xF];
+				out.Advance(6);
+				break;
 			}
-			else
-			{
-				result *= 10;
-				result += ((int)(data[index]) - 48);
-				if (inFraction)
-				{
-					fractionSize *= 10.0;
-				}
 			}
+			data = special + 1;
 		}
+	}
 
-		if (negative)
-		{
-			result *= -1;
-		}
-
-		result /= fractionSize;
-
-		if (exp)
+	inline size_t JSONObject::EscapedLength(StringData const& str)
+	{
+		char const* data = str.c_str();
+		char const* const end = data + str.length();
+		size_t length = str.length();
+		for (;;)
 		{
-			double mult = pow(10.0, expVal);
-			if (expNegative)
+			char const* const special = detail_::FindCharacterToEscape(data, end);
+			if (special == end)
 			{
-				result /= mult;
+				return length;
 			}
-			else
+			switch (*special)
 			{
-				result *= mult;
+			case '\"': case '\\': case '\b': case '\f': case '\n': case '\r': case '\t': length += 1; break;
+			default: length += 5; break;
 			}
+			data = special + 1;
 		}
+	}
 
+	inline std::string JSONObject::UnescapeString(StringData const& str)
+	{
+		std::string result;
+		UnescapeInto(str, result);
 		return result;
 	}
 
-	inline bool JSONObject::ToBool(StringData const& str)
+	inline void JSONObject::UnescapeInto(StringData const& str, std::string& out)
 	{
-		char const* const data = str.c_str();
 		size_t const length = str.length();
-		if (
-			length == 4 &&
-			data[0] == 't' &&
-			data[1] == 'r' &&
-			data[2] == 'u' &&
-			data[3] == 'e'
-			)
+		if (length == 0)
 		{
-			return true;
+			out.clear();
+			return;
 		}
-		return false;
+
+		// No escape is shorter than what it decodes to, so the output never outgrows the input.
+		out.resize(length);
+		out.resize(Unescape(str.c_str(), length, &out[0]));
 	}
 
-	inline std::string JSONObject::EscapeString(StringData const& str)
+	inline size_t JSONObject::Unescape(char const* data, size_t length, char* out)
 	{
-		std::stringstream builder;
-		const char* data = str.c_str();
-		const size_t length = str.length();
-		for (size_t index = 0; index < length; ++index)
+		char* write = out;
+		char const* const end = data + length;
+		for (;;)
 		{
-			switch (data[index])
+			char const* const backslash = detail_::FindBackslash(data, end);
+			memmove(write, data, size_t(backslash - data));
+			write += backslash - data;
+			data = backslash;
+			if (end - data < 2)
 			{
-			case '\"': builder << "\\\""; break;
-			case '\\': builder << "\\\\"; break;
-			case '\b': builder << "\\b"; break;
-			case '\f': builder << "\\f"; break;
-			case '\n': builder << "\\n"; break;
-			case '\r': builder << "\\r"; break;
-			case '\t': builder << "\\t"; break;
-			default: builder << data[index]; break;
+				if (data != end)
+				{
+					*write++ = '\\';
+				}
+				break;
 			}
-		}
-		return builder.str();
-	}
 
-	inline std::string JSONObject::UnescapeString(StringData const& str)
-	{
-		std::stringstream builder;
-		bool inEscape = false;
-		const char* data = str.c_str();
-		const size_t length = str.length();
-		for (size_t index = 0; index < length; ++index)
-		{
-			if (inEscape)
+			char const escaped = data[1];
+			data += 2;
+			switch (escaped)
 			{
-				switch (data[index])
+			case '\"': *write++ = '\"'; break;
+			case '\\': *write++ = '\\'; break;
+			case '/': *write++ = '/'; break;
+			case 'b': *write++ = '\b'; break;
+			case 'f': *write++ = '\f'; break;
+			case 'n': *write++ = '\n'; break;
+			case 'r': *write++ = '\r'; break;
+			case 't': *write++ = '\t'; break;
+			case 'u':
+			{
+				int32_t codePoint = end - data >= 4 ? detail_::DecodeHex4(data) : -1;
+				if (codePoint < 0)
 				{
-				case '\"': builder << '\"'; break;
-				case '\\': builder << '\\'; break;
-				case '/': builder << '/'; break;
-				case 'b': builder << '\b'; break;
-				case 'f': builder << '\f'; break;
-				case 'n': builder << '\n'; break;
-				case 'r': builder << '\r'; break;
-				case 't': builder << '\t'; break;
-				case 'u':
+					*write++ = '\\';
+					*write++ = 'u';
+					break;
+				}
+				data += 4;
+				if (codePoint >= 0xD800 && codePoint < 0xE000)
 				{
-					++index;
-					char digits[5];
-					memcpy(digits, &data[index], 5);
-					digits[4] = '\0';
-					union UnicodeChar
+					// A high surrogate followed by an escaped low surrogate is one code point.
+					// Anything else is unpaired and has no UTF-8 encoding.
+					int32_t low = -1;
+					if (codePoint < 0xDC00 && end - data >= 6 && data[0] == '\\' && data[1] == 'u')
 					{
-						int32_t asInt;
-						char asChar[4];
-					} ch;
-					ch.asInt = strtol(digits, nullptr, 16);
-
-					if (ch.asInt < 0x80) {
-						builder << ch.asChar[0];
+						low = detail_::DecodeHex4(data + 2);
 					}
-					else if (ch.asInt < 0x800) {
-						builder << char((ch.asInt >> 6) | 0xC0);
-						builder << char((ch.asInt & 0x3F) | 0x80);
-					}
-					else if (ch.asInt < 0x10000) {
-						builder << char((ch.asInt >> 12) | 0xE0);
-						builder << char(((ch.asInt >> 6) & 0x3F) | 0x80);
-						builder << char((ch.asInt & 0x3F) | 0x80);
+					if (low >= 0xDC00 && low < 0xE000)
+					{
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+						data += 6;
 					}
-					else if (ch.asInt < 0x110000) {
-						builder << char((ch.asInt >> 18) | 0xF0);
-						builder << char(((ch.asInt >> 12) & 0x3F) | 0x80);
-						builder << char(((ch.asInt >> 6) & 0x3F) | 0x80);
-						builder << char((ch.asInt & 0x3F) | 0x80);
+					else
+					{
+						codePoint = 0xFFFD;
 					}
-
-					index += 3;
-					break;
-				}
-				default: builder << '\\' << data[index]; break;
 				}
-				inEscape = false;
+				write += detail_::EncodeUtf8(uint32_t(codePoint), write);
+				break;
 			}
-			else
-			{
-				if (data[index] == '\\')
-				{
-					inEscape = true;
-				}
-				else
-				{
-					builder << data[index];
-				}
+			default: *write++ = '\\'; *write++ = escaped; break;
 			}
 		}
-		return builder.str();
+		return size_t(write - out);
 	}
 
 	inline JSONObject::Holder* JSONObject::Holder::Create()
@@ -1386,16 +2146,56 @@ namespace LightningJSON
 	{
 		typedef PoolAllocator<sizeof(JSONObject::Holder)> holderAlloc;
 
+		detail_::SourceBuffer* const source = holder->m_ownsSource ? SourceOf(holder) : nullptr;
 		holder->~Holder();
 		holderAlloc::free(holder);
+		if (source)
+		{
+			source->Release();
+		}
+	}
+
+	inline JSONObject::Holder* JSONObject::Holder::CreateWithSource(detail_::SourceBuffer* source)
+	{
+		typedef PoolAllocator<sizeof(JSONObject::Holder)> holderAlloc;
+
+		// Room for the Holder and, just after it, the pointer to the source.
+		size_t const count = (sizeof(Holder) + sizeof(detail_::SourceBuffer*) + sizeof(Holder) - 1) / sizeof(Holder);
+		Holder* const holder = (JSONObject::Holder*)holderAlloc::alloc(count);
+		SourceOf(holder) = source;
+		return holder;
+	}
+
+	inline detail_::SourceBuffer*& JSONObject::Holder::SourceOf(Holder* holder)
+	{
+		return *reinterpret_cast<detail_::SourceBuffer**>(reinterpret_cast<unsigned char*>(holder) + sizeof(Holder));
 	}
 
 	inline JSONObject::Holder::Holder(JSONType forType)
+		: Holder(forType, false)
+	{
+		//
+	}
+
+	inline JSONObject::Holder::Holder(JSONType forType, bool deferred)
 		: m_data(nullptr, 0)
 		, m_type(forType)
+		, m_ownsSource(false)
 		, refCount(1)
+		, m_deferred(deferred)
+		, m_numberClass(forType == JSONType::Double ? detail_::NumberClass::Double : detail_::NumberClass::Int64)
+		, m_hasEscapes(true)
+		, m_isConverted(false)
 	{
-		switch(forType)
+		if (!deferred)
+		{
+			InitChildren();
+		}
+	}
+
+	inline void JSONObject::Holder::InitChildren()
+	{
+		switch(m_type)
 		{
 		case JSONType::Array:
 			new(&m_children.asArray) TokenList();
@@ -1406,23 +2206,106 @@ namespace LightningJSON
 			m_children.asObject.Reserve(16);
 			break;
 		default:
+			new(&m_children.asScalar.converted) std::atomic<uint64_t>(0);
 			break;
 		}
 	}
 
 	inline JSONObject::Holder::~Holder()
 	{
+		if (!m_deferred)
+		{
+			switch (m_type)
+			{
+			case JSONType::Array:
+				m_children.asArray.~TokenList();
+				break;
+			case JSONType::Object:
+				m_children.asObject.~TokenMap();
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		if (m_type == JSONType::String && m_isConverted.load(std::memory_order_relaxed))
+		{
+			delete reinterpret_cast<std::string*>(uintptr_t(m_children.asScalar.converted.load(std::memory_order_relaxed)));
+		}
+	}
+
+	inline void JSONObject::Holder::CopyScalar(Holder const* other)
+	{
+		m_data = other->m_data;
+		if (other->m_data.c_str() == other->m_children.asScalar.text)
+		{
+			memcpy(m_children.asScalar.text, other->m_children.asScalar.text, sizeof(m_children.asScalar.text));
+			SetInlineText(other->m_data.length());
+		}
+		m_numberClass = other->m_numberClass;
+		m_hasEscapes = other->m_hasEscapes;
+		// An unescaped copy belongs to the string it was made for; the new one makes its own.
+		if (m_type != JSONType::String && other->m_isConverted.load(std::memory_order_acquire))
+		{
+			SetConverted(other->m_children.asScalar.converted.load(std::memory_order_relaxed));
+		}
+	}
+
+	inline void JSONObject::Holder::SetInlineText(size_t length)
+	{
+		m_children.asScalar.text[length] = '\0';
+		m_data = StringData(m_children.asScalar.text, length);
+	}
+
+	inline void JSONObject::Holder::SetConverted(uint64_t bits)
+	{
+		m_children.asScalar.converted.store(bits, std::memory_order_relaxed);
+		m_isConverted.store(true, std::memory_order_release);
+	}
+
+	inline void JSONObject::Holder::Convert()
+	{
+		// Threads that race here compute the same value, so either store may win.
 		switch (m_type)
 		{
-		case JSONType::Array:
-			m_children.asArray.~TokenList();
+		case JSONType::Integer:
+			SetConverted(ToUInt(m_data));
 			break;
-		case JSONType::Object:
-			m_children.asObject.~TokenMap();
+		case JSONType::Double:
+		{
+			double const value = ToNativeDouble(m_data);
+			uint64_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			SetConverted(bits);
 			break;
-
+		}
+		case JSONType::Boolean:
+			SetConverted(ToBool(m_data) ? 1 : 0);
+			break;
+		case JSONType::String:
+		{
+			// Unlike the other values, the copy is not the same on every thread, so only the
+			// first one to finish keeps its copy.
+			std::string* const unescaped = new std::string(UnescapeString(m_data));
+			uint64_t expected = 0;
+			if (m_children.asScalar.converted.compare_exchange_strong(expected, uint64_t(uintptr_t(unescaped)), std::memory_order_acq_rel))
+			{
+				m_isConverted.store(true, std::memory_order_release);
+			}
+			else
+			{
+				delete unescaped;
+			}
+			break;
+		}
 		default:
 			break;
 		}
 	}
+
+	inline void JSONObject::Holder::DetectEscapes()
+	{
+		m_hasEscapes = memchr(m_data.c_str(), '\\', m_data.length()) != nullptr;
+	}
 }
@@ -0,0 +1,573 @@
+#pragma once
+
+#include <charconv>
+#include <string>
+
+#include <float.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PowersOfFive.hpp"
+#include "Simd.hpp"
+
+namespace LightningJSON
+{
+	namespace detail_
+	{
+		// The cheapest exact conversion for a parsed number. Integers too large for 64 bits are
+		// classed, and typed, as doubles.
+		enum class NumberClass : uint8_t
+		{
+			Int64,
+			UInt64,
+			Double,
+		};
+
+		inline bool IsDigit(char c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		// Returns the number of consecutive ASCII digits in [data, end), testing eight at a time
+		// while eight bytes remain.
+		inline size_t CountDigits(char const* data, char const* end)
+		{
+			size_t count = 0;
+			while (end - (data + count) >= 8)
+			{
+				// A byte is a digit when its high nibble is 3 and adding 6 leaves it at 3.
+				uint64_t value;
+				memcpy(&value, data + count, sizeof(value));
+				uint64_t const nonDigit = ((value & 0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL)
+					| (((value + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL);
+				if (nonDigit != 0)
+				{
+					// Move every nonzero byte's flag to its high bit; no carry crosses a byte.
+					uint64_t const flags = (nonDigit | ((nonDigit & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL)) & 0x8080808080808080ULL;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+					return count + size_t(__builtin_clzll(flags) / 8);
+#else
+					return count + size_t(CountTrailingZeros(flags) / 8);
+#endif
+				}
+				count += 8;
+			}
+			while (data + count < end && IsDigit(data[count]))
+			{
+				++count;
+			}
+			return count;
+		}
+
+		// True if all eight bytes of chunk are ASCII digits.
+		inline bool IsEightDigits(uint64_t chunk)
+		{
+			return ((chunk & 0xF0F0F0F0F0F0F0F0ULL) | (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+		}
+
+		// Converts eight ASCII digits to their value in three multiplies, combining neighbouring
+		// digits, then pairs of digits, then groups of four.
+		inline uint32_t ParseEightDigits(uint64_t chunk)
+		{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			chunk = __builtin_bswap64(chunk);
+#endif
+			chunk -= 0x3030303030303030ULL;
+			chunk = (chunk * 10) + (chunk >> 8);
+			chunk = (((chunk & 0x000000FF000000FFULL) * 0x000F424000000064ULL) + (((chunk >> 16) & 0x000000FF000000FFULL) * 0x0000271000000001ULL)) >> 32;
+			return uint32_t(chunk);
+		}
+
+		// Appends the digits at data to value and advances data past them, eight at a time
+		// while it can. The result wraps if it does not fit in 64 bits.
+		inline uint64_t AccumulateDigits(char const*& data, char const* end, uint64_t value)
+		{
+			while (end - data >= 8)
+			{
+				uint64_t chunk;
+				memcpy(&chunk, data, sizeof(chunk));
+				if (!IsEightDigits(chunk))
+				{
+					break;
+				}
+				value = value * 100000000 + ParseEightDigits(chunk);
+				data += 8;
+			}
+			while (data < end && IsDigit(*data))
+			{
+				value = value * 10 + uint64_t(*data - '0');
+				++data;
+			}
+			return value;
+		}
+
+		// As AccumulateDigits starting from zero, but sets overflow instead of wrapping.
+		inline uint64_t ParseDigitsChecked(char const*& data, char const* end, bool& overflow)
+		{
+			overflow = false;
+			if (end - data <= 19)
+			{
+				// Nineteen digits always fit.
+				return AccumulateDigits(data, end, 0);
+			}
+
+			uint64_t value = 0;
+			for (; data < end && IsDigit(*data); ++data)
+			{
+				uint64_t const digit = uint64_t(*data - '0');
+				if (overflow || value > (UINT64_MAX - digit) / 10)
+				{
+					overflow = true;
+					continue;
+				}
+				value = value * 10 + digit;
+			}
+			return value;
+		}
+
+		// Reads an integer, with an optional minus sign, that fills [data, end). Returns false if
+		// the text is anything else; otherwise sets overflow if the magnitude needs more than 64 bits.
+		inline bool ParseInteger(char const* data, char const* end, uint64_t& magnitude, bool& negative, bool& overflow)
+		{
+			negative = data < end && *data == '-';
+			if (negative)
+			{
+				++data;
+			}
+			if (data == end)
+			{
+				return false;
+			}
+			magnitude = ParseDigitsChecked(data, end, overflow);
+			return data == end;
+		}
+
+		// Classes an integer of more than 18 digits, which may not fit in 64 bits.
+		inline NumberClass ClassifyLongInteger(char const* digits, size_t count, bool negative)
+		{
+			bool overflow;
+			uint64_t const value = ParseDigitsChecked(digits, digits + count, overflow);
+			if (overflow)
+			{
+				return NumberClass::Double;
+			}
+			if (negative)
+			{
+				return value <= uint64_t(INT64_MAX) + 1 ? NumberClass::Int64 : NumberClass::Double;
+			}
+			return value <= uint64_t(INT64_MAX) ? NumberClass::Int64 : NumberClass::UInt64;
+		}
+
+		// Scans one number following the JSON grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+		// On success, advances data past it, sets numberClass and returns true. Otherwise returns
+		// false with data at the character that broke the grammar. Nothing at or past end is read.
+		inline bool ScanNumber(char const*& data, char const* end, NumberClass& numberClass)
+		{
+			char const* p = data;
+			bool const negative = p < end && *p == '-';
+			if (negative)
+			{
+				++p;
+			}
+
+			char const* const digits = p;
+			size_t const integerDigits = CountDigits(p, end);
+			if (integerDigits == 0 || (*p == '0' && integerDigits > 1))
+			{
+				data = p;
+				return false;
+			}
+			p += integerDigits;
+
+			bool fractional = false;
+			if (p < end && *p == '.')
+			{
+				++p;
+				size_t const fractionDigits = CountDigits(p, end);
+				if (fractionDigits == 0)
+				{
+					data = p;
+					return false;
+				}
+				p += fractionDigits;
+				fractional = true;
+			}
+			if (p < end && (*p == 'e' || *p == 'E'))
+			{
+				++p;
+				if (p < end && (*p == '+' || *p == '-'))
+				{
+					++p;
+				}
+				size_t const exponentDigits = CountDigits(p, end);
+				if (exponentDigits == 0)
+				{
+					data = p;
+					return false;
+				}
+				p += exponentDigits;
+				fractional = true;
+			}
+
+			data = p;
+			if (fractional)
+			{
+				numberClass = NumberClass::Double;
+			}
+			else if (integerDigits <= 18)
+			{
+				numberClass = NumberClass::Int64;
+			}
+			else
+			{
+				numberClass = ClassifyLongInteger(digits, integerDigits, negative);
+			}
+			return true;
+		}
+
+		// A number split into a decimal significand and exponent: mantissa * 10^exponent.
+		struct DecimalNumber
+		{
+			uint64_t mantissa;
+			int64_t exponent;
+			bool negative;
+			// Set when nonzero digits beyond the 19 that fit in mantissa were dropped.
+			bool truncated;
+		};
+
+		inline DecimalNumber ParseDecimal(char const* data, char const* end)
+		{
+			DecimalNumber number = { 0, 0, false, false };
+			if (data < end && (*data == '-' || *data == '+'))
+			{
+				number.negative = *data == '-';
+				++data;
+			}
+
+			// Accumulate every digit; this wraps if there are more than 19, which is fixed up below.
+			char const* const integerStart = data;
+			number.mantissa = AccumulateDigits(data, end, 0);
+			char const* const integerEnd = data;
+			char const* fractionStart = data;
+			if (data < end && *data == '.')
+			{
+				fractionStart = ++data;
+				number.mantissa = AccumulateDigits(data, end, number.mantissa);
+				number.exponent = -int64_t(data - fractionStart);
+			}
+			char const* const fractionEnd = data;
+
+			if (data < end && (*data == 'e' || *data == 'E'))
+			{
+				++data;
+				bool negativeExponent = false;
+				if (data < end && (*data == '-' || *data == '+'))
+				{
+					negativeExponent = *data == '-';
+					++data;
+				}
+				int64_t exponent = 0;
+				for (; data < end && IsDigit(*data); ++data)
+				{
+					// Anything this large is zero or infinity anyway; stop before it can overflow.
+					if (exponent < 0x10000000)
+					{
+						exponent = exponent * 10 + (*data - '0');
+					}
+				}
+				number.exponent += negativeExponent ? -exponent : exponent;
+			}
+
+			size_t const digitCount = size_t(integerEnd - integerStart) + size_t(fractionEnd - fractionStart);
+			if (digitCount <= 19)
+			{
+				return number;
+			}
+
+			// Too many digits for the fast loop. Leading zeros do not count; if there are still
+			// more than 19, keep the first 19 and scale for the rest.
+			number.mantissa = 0;
+			size_t significantDigits = 0;
+			int64_t scale = 0;
+			auto const takeDigits = [&number, &significantDigits, &scale](char const* digit, char const* stop, bool inFraction)
+			{
+				for (; digit < stop; ++digit)
+				{
+					if (significantDigits < 19)
+					{
+						if (number.mantissa != 0 || *digit != '0')
+						{
+							number.mantissa = number.mantissa * 10 + uint64_t(*digit - '0');
+							++significantDigits;
+						}
+						if (inFraction)
+						{
+							--scale;
+						}
+					}
+					else
+					{
+						if (!inFraction)
+						{
+							++scale;
+						}
+						number.truncated |= *digit != '0';
+					}
+				}
+			};
+			takeDigits(integerStart, integerEnd, false);
+			takeDigits(fractionStart, fractionEnd, true);
+			number.exponent += scale + int64_t(fractionEnd - fractionStart);
+			return number;
+		}
+
+		struct UInt128
+		{
+			uint64_t low;
+			uint64_t high;
+		};
+
+#if defined(__SIZEOF_INT128__)
+		// __extension__ keeps -Wpedantic quiet about the non-standard type.
+		__extension__ typedef unsigned __int128 UInt128Native;
+#endif
+
+		inline UInt128 Multiply(uint64_t a, uint64_t b)
+		{
+#if defined(__SIZEOF_INT128__)
+			UInt128Native const product = UInt128Native(a) * b;
+			return UInt128{ uint64_t(product), uint64_t(product >> 64) };
+#elif defined(_MSC_VER) && defined(_M_X64)
+			UInt128 result;
+			result.low = _umul128(a, b, &result.high);
+			return result;
+#else
+			uint64_t const aLow = a & 0xFFFFFFFF;
+			uint64_t const aHigh = a >> 32;
+			uint64_t const bLow = b & 0xFFFFFFFF;
+			uint64_t const bHigh = b >> 32;
+			uint64_t const lowLow = aLow * bLow;
+			uint64_t const lowHigh = aLow * bHigh;
+			uint64_t const highLow = aHigh * bLow;
+			uint64_t const middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFF) + (highLow & 0xFFFFFFFF);
+			return UInt128{ (middle << 32) | (lowLow & 0xFFFFFFFF), aHigh * bHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32) };
+#endif
+		}
+
+		// Eisel and Lemire, "Number Parsing at a Gigabyte per Second" (2021), with the bound from
+		// Mushtak and Lemire (2023) that makes a fallback unnecessary for significands of up to 19
+		// digits. Returns the bits of the double nearest mantissa * 10^exponent, without the sign.
+		inline uint64_t EiselLemire(uint64_t mantissa, int64_t exponent)
+		{
+			static constexpr int mantissaBits = 52;
+			static constexpr uint64_t infinity = uint64_t(0x7FF) << mantissaBits;
+
+			if (mantissa == 0 || exponent < SmallestPowerOfFive)
+			{
+				return 0;
+			}
+			if (exponent > LargestPowerOfFive)
+			{
+				return infinity;
+			}
+
+			int const q = int(exponent);
+			int const leadingZeros = CountLeadingZeros(mantissa);
+			mantissa <<= leadingZeros;
+
+			// Multiply by the 128-bit power of five, using the low half only when the high half
+			// leaves the rounding undecided.
+			size_t const index = 2 * size_t(q - SmallestPowerOfFive);
+			UInt128 product = Multiply(mantissa, PowersOfFive[index]);
+			uint64_t const precisionMask = ~uint64_t(0) >> (mantissaBits + 3);
+			if ((product.high & precisionMask) == precisionMask)
+			{
+				UInt128 const second = Multiply(mantissa, PowersOfFive[index + 1]);
+				product.low += second.high;
+				if (second.high > product.low)
+				{
+					++product.high;
+				}
+			}
+
+			int const upperBit = int(product.high >> 63);
+			int const shift = upperBit + 64 - mantissaBits - 3;
+			uint64_t significand = product.high >> shift;
+			// floor(log2(10^q)) + 63, plus the exponent bias.
+			int power2 = int(((int64_t(152170 + 65536) * q) >> 16) + 63) + upperBit - leadingZeros + 1023;
+
+			if (power2 <= 0)
+			{
+				// Subnormal, or too small even for that.
+				if (-power2 + 1 >= 64)
+				{
+					return 0;
+				}
+				significand >>= -power2 + 1;
+				significand += significand & 1;
+				significand >>= 1;
+				// If rounding carried into bit 52, this is exactly the smallest normal double.
+				return significand;
+			}
+
+			// Exactly halfway between two doubles: round to even. This can only happen for small q.
+			if (product.low <= 1 && q >= -4 && q <= 23 && (significand & 3) == 1 && (significand << shift) == product.high)
+			{
+				significand &= ~uint64_t(1);
+			}
+
+			significand += significand & 1;
+			significand >>= 1;
+			if (significand >= (uint64_t(2) << mantissaBits))
+			{
+				significand = uint64_t(1) << mantissaBits;
+				++power2;
+			}
+			significand &= ~(uint64_t(1) << mantissaBits);
+			if (power2 >= 0x7FF)
+			{
+				return infinity;
+			}
+			return significand | (uint64_t(power2) << mantissaBits);
+		}
+
+		// Exact, but slow; for the rare significands where the fast paths cannot decide.
+		inline double ParseDoubleSlow(char const* data, char const* end)
+		{
+#if defined(__cpp_lib_to_chars)
+			double value = 0;
+			std::from_chars(data, end, value);
+			return value;
+#else
+			std::string const copy(data, end);
+			return strtod(copy.c_str(), nullptr);
+#endif
+		}
+
+		// Converts the number in [data, end) to the nearest double.
+		inline double ParseDouble(char const* data, char const* end)
+		{
+			DecimalNumber const number = ParseDecimal(data, end);
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+			// Both operands are exact doubles, so one correctly rounded operation gives the answer.
+			if (!number.truncated && number.exponent >= -22 && number.exponent <= 22 && number.mantissa <= (uint64_t(1) << 53))
+			{
+				static constexpr double powersOfTen[] =
+				{
+					1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+					1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+				};
+				double value = double(number.mantissa);
+				if (number.exponent < 0)
+				{
+					value /= powersOfTen[-number.exponent];
+				}
+				else
+				{
+					value *= powersOfTen[number.exponent];
+				}
+				return number.negative ? -value : value;
+			}
+#endif
+
+			uint64_t bits = EiselLemire(number.mantissa, number.exponent);
+			if (number.truncated && EiselLemire(number.mantissa + 1, number.exponent) != bits)
+			{
+				// The dropped digits decide the rounding.
+				return ParseDoubleSlow(data, end);
+			}
+
+			if (number.negative)
+			{
+				bits |= uint64_t(1) << 63;
+			}
+			double value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		// Room for any 64-bit integer or shortest round-trip double, and a terminator.
+		inline constexpr size_t FormattedNumberSize = 32;
+
+		// "00" through "99", for writing integers two digits at a time.
+		inline constexpr char DigitPairs[201] =
+			"0001020304050607080910111213141516171819"
+			"2021222324252627282930313233343536373839"
+			"4041424344454647484950515253545556575859"
+			"6061626364656667686970717273747576777879"
+			"8081828384858687888990919293949596979899";
+
+		inline size_t CountDecimalDigits(uint64_t value)
+		{
+			static constexpr uint64_t powersOfTen[] =
+			{
+				1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+				100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+				10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+				100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+			};
+			// The bit length times log10(2) (about 1233 / 4096) is the digit count or one short of it.
+			// Setting the low bit makes zero count as one digit, and cannot cross a power of ten.
+			value |= 1;
+			int const estimate = ((64 - CountLeadingZeros(value)) * 1233) >> 12;
+			return size_t(estimate) + (value >= powersOfTen[estimate] ? 1 : 0);
+		}
+
+		// Writes value in decimal to out and returns the number of characters written.
+		inline size_t FormatUnsigned(uint64_t value, char* out)
+		{
+			size_t const length = CountDecimalDigits(value);
+			char* write = out + length;
+			while (value >= 100)
+			{
+				uint64_t const pair = value % 100;
+				value /= 100;
+				write -= 2;
+				memcpy(write, DigitPairs + pair * 2, 2);
+			}
+			if (value >= 10)
+			{
+				memcpy(write - 2, DigitPairs + value * 2, 2);
+			}
+			else
+			{
+				*(write - 1) = char('0' + value);
+			}
+			return length;
+		}
+
+		inline size_t FormatInteger(int64_t value, char* out)
+		{
+			// The sign is always written, and overwritten by the digits if the value is not negative.
+			size_t const negative = value < 0 ? 1 : 0;
+			uint64_t const magnitude = negative ? 0 - uint64_t(value) : uint64_t(value);
+			*out = '-';
+			return negative + FormatUnsigned(magnitude, out + negative);
+		}
+
+		// Writes the shortest decimal that reads back as exactly value, and returns its length.
+		// out must have room for FormattedNumberSize characters.
+		inline size_t FormatDouble(double value, char* out)
+		{
+#if defined(__cpp_lib_to_chars)
+			return size_t(std::to_chars(out, out + FormattedNumberSize - 1, value).ptr - out);
+#else
+			// Seventeen significant digits always round-trip; try fewer first.
+			int length = 0;
+			for (int precision = 1; precision <= 17; ++precision)
+			{
+				length = snprintf(out, FormattedNumberSize, "%.*g", precision, value);
+				if (strtod(out, nullptr) == value)
+				{
+					break;
+				}
+			}
+			return size_t(length);
+#endif
+		}
+	}
+}
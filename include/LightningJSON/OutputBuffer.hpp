@@ -0,0 +1,257 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <stddef.h>
+#include <string.h>
+
+#include "JSONSink.hpp"
+
+namespace LightningJSON
+{
+	namespace detail_
+	{
+		// A contiguous, growable buffer for building output, written straight into a std::string.
+		// The string's existing capacity is reused, so passing the same string for every document
+		// stops allocating once it has grown to fit the largest one. Call Finish() when done to
+		// trim the string to what was written.
+		//
+		// Given a sink instead, the buffer holds about a chunk and passes each full one to the
+		// sink, so memory use stays bounded however much is written. Finish() passes on whatever
+		// is left.
+		class OutputBuffer
+		{
+		public:
+			explicit OutputBuffer(std::string& out)
+				: m_chunk()
+				, m_out(out)
+				, m_sink(nullptr)
+				, m_chunkSize(0)
+				, m_pos(nullptr)
+				, m_end(nullptr)
+			{
+				m_out.clear();
+				m_pos = m_out.data();
+				m_end = m_pos;
+			}
+
+			OutputBuffer(JSONSink& sink, size_t chunkSize)
+				: m_chunk(chunkSize > 0 ? chunkSize : 1, '\0')
+				, m_out(m_chunk)
+				, m_sink(&sink)
+				, m_chunkSize(m_chunk.size())
+				, m_pos(m_chunk.data())
+				, m_end(m_chunk.data() + m_chunk.size())
+			{
+				//
+			}
+
+			OutputBuffer(OutputBuffer const&) = delete;
+			OutputBuffer& operator=(OutputBuffer const&) = delete;
+
+			// Returns room for at least count more characters. Write into it and then Advance()
+			// past what was written.
+			char* Reserve(size_t count)
+			{
+				if (size_t(m_end - m_pos) < count)
+				{
+					Grow(count);
+				}
+				return m_pos;
+			}
+
+			void Advance(size_t count)
+			{
+				m_pos += count;
+			}
+
+			void Append(char c)
+			{
+				*Reserve(1) = c;
+				++m_pos;
+			}
+
+			void Append(char c, size_t count)
+			{
+				memset(Reserve(count), c, count);
+				m_pos += count;
+			}
+
+			void Append(char const* data, size_t length)
+			{
+				if (size_t(m_end - m_pos) < length)
+				{
+					AppendSlow(data, length);
+					return;
+				}
+				memcpy(m_pos, data, length);
+				m_pos += length;
+			}
+
+			void Append(std::string_view const& str)
+			{
+				Append(str.data(), str.length());
+			}
+
+			size_t Size() const
+			{
+				return size_t(m_pos - m_out.data());
+			}
+
+			void Finish()
+			{
+				if (m_sink)
+				{
+					WriteChunks();
+					if (Size() != 0)
+					{
+						m_sink->Write(m_out.data(), Size());
+					}
+					m_pos = m_out.data();
+					return;
+				}
+				m_out.resize(Size());
+			}
+
+		private:
+			// Passes every full chunk to the sink and moves what is left to the front.
+			void WriteChunks()
+			{
+				char* const begin = m_out.data();
+				char const* chunk = begin;
+				while (size_t(m_pos - chunk) >= m_chunkSize)
+				{
+					m_sink->Write(chunk, m_chunkSize);
+					chunk += m_chunkSize;
+				}
+				size_t const remaining = size_t(m_pos - chunk);
+				memmove(begin, chunk, remaining);
+				m_pos = begin + remaining;
+			}
+
+			void AppendSlow(char const* data, size_t length)
+			{
+				if (!m_sink)
+				{
+					Grow(length);
+					memcpy(m_pos, data, length);
+					m_pos += length;
+					return;
+				}
+				// Fill the buffer to the end each time, rather than growing it.
+				for (;;)
+				{
+					size_t const room = size_t(m_end - m_pos);
+					size_t const count = length < room ? length : room;
+					memcpy(m_pos, data, count);
+					m_pos += count;
+					data += count;
+					length -= count;
+					if (length == 0)
+					{
+						return;
+					}
+					WriteChunks();
+				}
+			}
+
+			void Grow(size_t count)
+			{
+				if (m_sink)
+				{
+					WriteChunks();
+					if (size_t(m_end - m_pos) < count)
+					{
+						// Room for a write that straddles the end of a chunk; the next call
+						// passes the chunk on and moves the rest back down.
+						size_t const used = Size();
+						m_out.resize(used + count);
+						m_pos = m_out.data() + used;
+						m_end = m_out.data() + m_out.size();
+					}
+					return;
+				}
+
+				static constexpr size_t minimumSize = 256;
+
+				size_t const used = Size();
+				size_t size = m_out.size() * 2;
+				if (size < used + count)
+				{
+					size = used + count;
+				}
+				if (size < minimumSize)
+				{
+					size = minimumSize;
+				}
+				// Growing within the existing capacity only fills in the new characters.
+				m_out.resize(size);
+				m_pos = m_out.data() + used;
+				m_end = m_out.data() + m_out.size();
+			}
+
+			// The chunk, when writing to a sink.
+			std::string m_chunk;
+			std::string& m_out;
+			JSONSink* m_sink;
+			size_t m_chunkSize;
+			char* m_pos;
+			char* m_end;
+		};
+
+		// The same interface as OutputBuffer, writing into memory the caller has already sized
+		// to fit, so nothing is checked.
+		class UncheckedOutputBuffer
+		{
+		public:
+			explicit UncheckedOutputBuffer(char* data)
+				: m_begin(data)
+				, m_pos(data)
+			{
+				//
+			}
+
+			char* Reserve(size_t)
+			{
+				return m_pos;
+			}
+
+			void Advance(size_t count)
+			{
+				m_pos += count;
+			}
+
+			void Append(char c)
+			{
+				*m_pos++ = c;
+			}
+
+			void Append(char c, size_t count)
+			{
+				memset(m_pos, c, count);
+				m_pos += count;
+			}
+
+			void Append(char const* data, size_t length)
+			{
+				memcpy(m_pos, data, length);
+				m_pos += length;
+			}
+
+			void Append(std::string_view const& str)
+			{
+				Append(str.data(), str.length());
+			}
+
+			size_t Size() const
+			{
+				return size_t(m_pos - m_begin);
+			}
+
+		private:
+			char* m_begin;
+			char* m_pos;
+		};
+	}
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
+
 #include <stdint.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -18,11 +21,32 @@ namespace LightningJSON
 	template<size_t sizeOfType>
 	struct MemoryBit
 	{
+		// The MemoryPool the block belongs to, or null if it came from malloc.
 		void* allocType;
 		MemoryBit* next;
 		unsigned char data[sizeOfType];
 	};
 
+	// The blocks owned by one thread. Only the owner uses freeList; other threads hand blocks
+	// back through remoteFrees, which the owner takes over whole when freeList runs out. When
+	// its thread exits, a pool is kept for the next new thread rather than released, since
+	// its blocks may still be in use elsewhere.
+	template<size_t sizeOfType>
+	struct MemoryPool
+	{
+		MemoryPool()
+			: freeList(nullptr)
+			, remoteFrees(nullptr)
+			, nextOrphan(nullptr)
+		{
+			//
+		}
+
+		MemoryBit<sizeOfType>* freeList;
+		std::atomic<MemoryBit<sizeOfType>*> remoteFrees;
+		MemoryPool* nextOrphan;
+	};
+
 	template<size_t sizeOfType>
 	class PoolAllocator
 	{
@@ -38,7 +62,21 @@ namespace LightningJSON
 		};
 
 	private:
-		static thread_local MemoryBit<sizeOfType>* ms_firstBit;
+		struct ThreadExit
+		{
+			~ThreadExit();
+
+			MemoryPool<sizeOfType>* pool;
+		};
+
+		static MemoryPool<sizeOfType>* attachPool_();
+		static MemoryBit<sizeOfType>* allocBits_(MemoryPool<sizeOfType>* pool);
+
+		static thread_local MemoryPool<sizeOfType>* ms_pool;
+		static thread_local ThreadExit ms_threadExit;
+		// Pools whose threads have exited.
+		static MemoryPool<sizeOfType>* ms_orphans;
+		static std::mutex ms_orphanMutex;
 
 		static inline constexpr size_t max_(size_t a, size_t b)
 		{
@@ -56,27 +94,53 @@ namespace LightningJSON
 	};
 
 	template<size_t sizeOfType>
-	thread_local MemoryBit<sizeOfType>* PoolAllocator<sizeOfType>::ms_firstBit = nullptr;
+	thread_local MemoryPool<sizeOfType>* PoolAllocator<sizeOfType>::ms_pool = nullptr;
 
 	template<size_t sizeOfType>
-	void* PoolAllocator<sizeOfType>::alloc(size_t count)
+	thread_local typename PoolAllocator<sizeOfType>::ThreadExit PoolAllocator<sizeOfType>::ms_threadExit;
+
+	template<size_t sizeOfType>
+	MemoryPool<sizeOfType>* PoolAllocator<sizeOfType>::ms_orphans = nullptr;
+
+	template<size_t sizeOfType>
+	std::mutex PoolAllocator<sizeOfType>::ms_orphanMutex;
+
+	template<size_t sizeOfType>
+	PoolAllocator<sizeOfType>::ThreadExit::~ThreadExit()
 	{
-		void* ret = malloc(count * sizeOfType + (sizeof(intptr_t) * 2));
-		memset(ret, 1, sizeof(intptr_t) * 2);
-		return reinterpret_cast<unsigned char*>(ret) + (sizeof(intptr_t) * 2);
+		if (pool)
+		{
+			std::lock_guard<std::mutex> lock(ms_orphanMutex);
+			pool->nextOrphan = ms_orphans;
+			ms_orphans = pool;
+		}
+		ms_pool = nullptr;
 	}
 
 	template<size_t sizeOfType>
-	void* PoolAllocator<sizeOfType>::alloc()
+	MemoryPool<sizeOfType>* PoolAllocator<sizeOfType>::attachPool_()
 	{
-		MemoryBit<sizeOfType>* bit = ms_firstBit;
-
-		if (bit)
+		MemoryPool<sizeOfType>* pool;
+		{
+			std::lock_guard<std::mutex> lock(ms_orphanMutex);
+			pool = ms_orphans;
+			if (pool)
+			{
+				ms_orphans = pool->nextOrphan;
+			}
+		}
+		if (!pool)
 		{
-			ms_firstBit = bit->next;
-			return bit->data;
+			pool = new MemoryPool<sizeOfType>();
 		}
+		ms_pool = pool;
+		ms_threadExit.pool = pool;
+		return pool;
+	}
 
+	template<size_t sizeOfType>
+	MemoryBit<sizeOfType>* PoolAllocator<sizeOfType>::allocBits_(MemoryPool<sizeOfType>* pool)
+	{
 		MemoryBit<sizeOfType>* newBits = (MemoryBit<sizeOfType>*)
 #ifdef _WIN32
 			VirtualAlloc(nullptr, ms_allocSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
@@ -84,35 +148,71 @@ namespace LightningJSON
 			mmap(nullptr, ms_allocSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
 #endif
 		size_t const maxBlock = ms_blocksPerAlloc - 1;
-		for (size_t i = 1; i < maxBlock; ++i)
+		for (size_t i = 0; i < maxBlock; ++i)
 		{
-			newBits[i].allocType = 0;
+			newBits[i].allocType = pool;
 			newBits[i].next = &newBits[i + 1];
 		}
-		newBits[maxBlock].allocType = 0;
+		newBits[maxBlock].allocType = pool;
 		newBits[maxBlock].next = nullptr;
 
-		newBits[0].allocType = 0;
+		return newBits;
+	}
 
-		ms_firstBit = &newBits[1];
+	template<size_t sizeOfType>
+	void* PoolAllocator<sizeOfType>::alloc(size_t count)
+	{
+		void* ret = malloc(count * sizeOfType + (sizeof(intptr_t) * 2));
+		memset(ret, 0, sizeof(intptr_t) * 2);
+		return reinterpret_cast<unsigned char*>(ret) + (sizeof(intptr_t) * 2);
+	}
 
-		return newBits[0].data;
+	template<size_t sizeOfType>
+	void* PoolAllocator<sizeOfType>::alloc()
+	{
+		MemoryPool<sizeOfType>* pool = ms_pool;
+		if (!pool)
+		{
+			pool = attachPool_();
+		}
+
+		MemoryBit<sizeOfType>* bit = pool->freeList;
+		if (!bit)
+		{
+			bit = pool->remoteFrees.exchange(nullptr, std::memory_order_acquire);
+			if (!bit)
+			{
+				bit = allocBits_(pool);
+			}
+		}
+
+		pool->freeList = bit->next;
+		return bit->data;
 	}
 
 	template<size_t sizeOfType>
 	void PoolAllocator<sizeOfType>::free(void* addr)
 	{
-		void* allocType = reinterpret_cast<void*>(reinterpret_cast<intptr_t*>(addr)[-2]);
-		if (allocType == 0)
+		MemoryBit<sizeOfType>* bit = reinterpret_cast<MemoryBit<sizeOfType>*>(reinterpret_cast<intptr_t*>(addr) - 2);
+		MemoryPool<sizeOfType>* owner = static_cast<MemoryPool<sizeOfType>*>(bit->allocType);
+		if (!owner)
 		{
-			MemoryBit<sizeOfType>* bit = reinterpret_cast<MemoryBit<sizeOfType>*>(reinterpret_cast<intptr_t*>(addr) - 2);
-
-			bit->next = ms_firstBit;
-			ms_firstBit = bit;
+			::free(bit);
+		}
+		else if (owner == ms_pool)
+		{
+			bit->next = owner->freeList;
+			owner->freeList = bit;
 		}
 		else
 		{
-			::free(reinterpret_cast<intptr_t*>(addr) - 2);
+			// Give the block back to the thread it came from, so that blocks allocated on one
+			// thread and freed on another are reused rather than piling up on the freeing side.
+			MemoryBit<sizeOfType>* head = owner->remoteFrees.load(std::memory_order_relaxed);
+			do
+			{
+				bit->next = head;
+			} while (!owner->remoteFrees.compare_exchange_weak(head, bit, std::memory_order_release, std::memory_order_relaxed));
 		}
 	}
 }
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Set LIGHTNINGJSON_SIMD to 0 to force the portable scalar code paths.
+#ifndef LIGHTNINGJSON_SIMD
+#	define LIGHTNINGJSON_SIMD 1
+#endif
+
+#if LIGHTNINGJSON_SIMD && defined(__AVX2__)
+#	define LIGHTNINGJSON_AVX2 1
+#else
+#	define LIGHTNINGJSON_AVX2 0
+#endif
+
+#if LIGHTNINGJSON_SIMD && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#	define LIGHTNINGJSON_SSE2 1
+#else
+#	define LIGHTNINGJSON_SSE2 0
+#endif
+
+// AVX2 implies SSSE3; MSVC defines no macro for SSSE3 alone.
+#if LIGHTNINGJSON_SIMD && (LIGHTNINGJSON_AVX2 || defined(__SSSE3__))
+#	define LIGHTNINGJSON_SSSE3 1
+#else
+#	define LIGHTNINGJSON_SSSE3 0
+#endif
+
+#if LIGHTNINGJSON_SIMD && (defined(__PCLMUL__) || (defined(_MSC_VER) && LIGHTNINGJSON_AVX2))
+#	define LIGHTNINGJSON_PCLMUL 1
+#else
+#	define LIGHTNINGJSON_PCLMUL 0
+#endif
+
+#if LIGHTNINGJSON_AVX2 || LIGHTNINGJSON_PCLMUL
+#	include <immintrin.h>
+#elif LIGHTNINGJSON_SSSE3
+#	include <tmmintrin.h>
+#elif LIGHTNINGJSON_SSE2
+#	include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#	include <intrin.h>
+#endif
+
+namespace LightningJSON
+{
+	namespace detail_
+	{
+		inline int CountTrailingZeros(uint64_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return int(index);
+#else
+			return __builtin_ctzll(value);
+#endif
+		}
+
+		inline int CountTrailingZeros(uint32_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, value);
+			return int(index);
+#else
+			return __builtin_ctz(value);
+#endif
+		}
+
+		inline int CountLeadingZeros(uint64_t value)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return 63 - int(index);
+#else
+			return __builtin_clzll(value);
+#endif
+		}
+
+		// Computes, for each bit, the xor of that bit and every bit below it.
+		// Used to turn a mask of quote characters into a mask of string interiors.
+		inline uint64_t PrefixXor(uint64_t bits)
+		{
+#if LIGHTNINGJSON_PCLMUL
+			__m128i const all = _mm_set1_epi8(char(0xFF));
+			__m128i const result = _mm_clmulepi64_si128(_mm_set_epi64x(0, int64_t(bits)), all, 0);
+			return uint64_t(_mm_cvtsi128_si64(result));
+#else
+			bits ^= bits << 1;
+			bits ^= bits << 2;
+			bits ^= bits << 4;
+			bits ^= bits << 8;
+			bits ^= bits << 16;
+			bits ^= bits << 32;
+			return bits;
+#endif
+		}
+
+		inline bool IsWhitespace(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+		}
+
+		// The widest vector available, with just enough operations to build character-set matchers.
+#if LIGHTNINGJSON_AVX2
+		typedef __m256i Vector;
+		static constexpr size_t VectorSize = 32;
+		inline Vector LoadAligned(char const* data) { return _mm256_load_si256(reinterpret_cast<__m256i const*>(data)); }
+		inline Vector LoadUnaligned(char const* data) { return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data)); }
+		inline Vector Splat(char c) { return _mm256_set1_epi8(c); }
+		inline Vector Equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+		inline Vector Or(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+		inline Vector MaxUnsigned(Vector a, Vector b) { return _mm256_max_epu8(a, b); }
+		inline uint32_t MoveMask(Vector v) { return uint32_t(_mm256_movemask_epi8(v)); }
+		inline Vector Zero() { return _mm256_setzero_si256(); }
+		inline Vector And(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+		inline Vector Xor(Vector a, Vector b) { return _mm256_xor_si256(a, b); }
+		inline Vector SubtractSaturated(Vector a, Vector b) { return _mm256_subs_epu8(a, b); }
+		inline Vector HighNibbles(Vector v) { return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F)); }
+		inline bool IsZero(Vector v) { return _mm256_testz_si256(v, v) != 0; }
+		// Looks up each byte of indices, which must be below 16, in a 16-byte table repeated in each lane.
+		inline Vector Lookup16(Vector table, Vector indices) { return _mm256_shuffle_epi8(table, indices); }
+		// Each byte of current lined up with the one N positions before it, reaching back into previous.
+		template<int N>
+		inline Vector Previous(Vector previous, Vector current) { return _mm256_alignr_epi8(current, _mm256_permute2x128_si256(previous, current, 0x21), 16 - N); }
+#elif LIGHTNINGJSON_SSE2
+		typedef __m128i Vector;
+		static constexpr size_t VectorSize = 16;
+		inline Vector LoadAligned(char const* data) { return _mm_load_si128(reinterpret_cast<__m128i const*>(data)); }
+		inline Vector LoadUnaligned(char const* data) { return _mm_loadu_si128(reinterpret_cast<__m128i const*>(data)); }
+		inline Vector Splat(char c) { return _mm_set1_epi8(c); }
+		inline Vector Equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+		inline Vector Or(Vector a, Vector b) { return _mm_or_si128(a, b); }
+		inline Vector MaxUnsigned(Vector a, Vector b) { return _mm_max_epu8(a, b); }
+		inline uint32_t MoveMask(Vector v) { return uint32_t(_mm_movemask_epi8(v)); }
+		inline Vector Zero() { return _mm_setzero_si128(); }
+		inline Vector And(Vector a, Vector b) { return _mm_and_si128(a, b); }
+		inline Vector Xor(Vector a, Vector b) { return _mm_xor_si128(a, b); }
+		inline Vector SubtractSaturated(Vector a, Vector b) { return _mm_subs_epu8(a, b); }
+		inline Vector HighNibbles(Vector v) { return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0F)); }
+		inline bool IsZero(Vector v) { return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF; }
+#	if LIGHTNINGJSON_SSSE3
+		inline Vector Lookup16(Vector table, Vector indices) { return _mm_shuffle_epi8(table, indices); }
+		template<int N>
+		inline Vector Previous(Vector previous, Vector current) { return _mm_alignr_epi8(current, previous, 16 - N); }
+#	endif
+#endif
+
+		// Returns a pointer to the first character in [data, end) accepted by t_Matcher, or end
+		// if there is none. Nothing at or past end is read: whole vectors are only loaded while
+		// they fit, and the last partial vector is finished one character at a time.
+		// t_Matcher provides Match(char) and, when SIMD is enabled, Mask(Vector) returning
+		// a movemask-style bitmask of the matching bytes.
+		template<typename t_Matcher>
+		inline char const* FindFirst(char const* data, char const* end)
+		{
+#if LIGHTNINGJSON_AVX2 || LIGHTNINGJSON_SSE2
+			if (size_t(end - data) >= VectorSize)
+			{
+				uint32_t mask = t_Matcher::Mask(LoadUnaligned(data));
+				if (mask)
+				{
+					return data + CountTrailingZeros(mask);
+				}
+				// Continue from the next aligned block; it may overlap the bytes just checked.
+				char const* block = data + VectorSize - (uintptr_t(data) & (VectorSize - 1));
+				while (size_t(end - block) >= VectorSize)
+				{
+					mask = t_Matcher::Mask(LoadAligned(block));
+					if (mask)
+					{
+						return block + CountTrailingZeros(mask);
+					}
+					block += VectorSize;
+				}
+				data = block;
+			}
+#endif
+			while (data < end && !t_Matcher::Match(*data))
+			{
+				++data;
+			}
+			return data;
+		}
+
+		struct NonWhitespaceMatcher
+		{
+			static bool Match(char c)
+			{
+				return !IsWhitespace(c);
+			}
+
+#if LIGHTNINGJSON_AVX2 || LIGHTNINGJSON_SSE2
+			static uint32_t Mask(Vector v)
+			{
+				Vector const ws = Or(Or(Equal(v, Splat(' ')), Equal(v, Splat('\t'))), Or(Equal(v, Splat('\n')), Equal(v, Splat('\r'))));
+				return ~MoveMask(ws) & uint32_t((uint64_t(1) << VectorSize) - 1);
+			}
+#endif
+		};
+
+		// Everything that matters when scanning a string: its closing quote and escapes.
+		struct StringTokenMatcher
+		{
+			static bool Match(char c)
+			{
+				return c == '"' || c == '\\';
+			}
+
+#if LIGHTNINGJSON_AVX2 || LIGHTNINGJSON_SSE2
+			static uint32_t Mask(Vector v)
+			{
+				return MoveMask(Or(Equal(v, Splat('"')), Equal(v, Splat('\\'))));
+			}
+#endif
+		};
+
+		struct BackslashMatcher
+		{
+			static bool Match(char c)
+			{
+				return c == '\\';
+			}
+
+#if LIGHTNINGJSON_AVX2 || LIGHTNINGJSON_SSE2
+			static uint32_t Mask(Vector v)
+			{
+				return MoveMask(Equal(v, Splat('\\')));
+			}
+#endif
+		};
+
+		// The characters a JSON string cannot contain as they are: quotes, backslashes and control characters.
+		struct EscapeMatcher
+		{
+			static bool Match(char c)
+			{
+				return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+			}
+
+#if LIGHTNINGJSON_AVX2 || LIGHTNINGJSON_SSE2
+			static uint32_t Mask(Vector v)
+			{
+				// Bytes no greater than 0x1F are left unchanged by an unsigned max with 0x1F.
+				Vector const control = Equal(MaxUnsigned(v, Splat(0x1F)), Splat(0x1F));
+				return MoveMask(Or(control, Or(Equal(v, Splat('"')), Equal(v, Splat('\\')))));
+			}
+#endif
+		};
+
+		// Everything that matters when skimming over a container without parsing it.
+		struct ContainerTokenMatcher
+		{
+			static bool Match(char c)
+			{
+				return c == '{' || c == '}' || c == '[' || c == ']' || c == '"';
+			}
+
+#if LIGHTNINGJSON_AVX2 || LIGHTNINGJSON_SSE2
+			static uint32_t Mask(Vector v)
+			{
+				Vector const brackets = Or(Or(Equal(v, Splat('{')), Equal(v, Splat('}'))), Or(Equal(v, Splat('[')), Equal(v, Splat(']'))));
+				return MoveMask(Or(brackets, Equal(v, Splat('"'))));
+			}
+#endif
+		};
+
+		inline char const* FindNonWhitespace(char const* data, char const* end)
+		{
+			return FindFirst<NonWhitespaceMatcher>(data, end);
+		}
+
+		inline char const* FindStringToken(char const* data, char const* end)
+		{
+			return FindFirst<StringTokenMatcher>(data, end);
+		}
+
+		inline char const* FindContainerToken(char const* data, char const* end)
+		{
+			return FindFirst<ContainerTokenMatcher>(data, end);
+		}
+
+		inline char const* FindBackslash(char const* data, char const* end)
+		{
+			return FindFirst<BackslashMatcher>(data, end);
+		}
+
+		inline char const* FindCharacterToEscape(char const* data, char const* end)
+		{
+			return FindFirst<EscapeMatcher>(data, end);
+		}
+
+		// 64 bytes of input, classified in bulk. Each query returns a mask with bit N set
+		// when byte N of the block matches.
+		class Block64
+		{
+		public:
+			explicit Block64(char const* data)
+			{
+#if LIGHTNINGJSON_AVX2
+				m_chunks[0] = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data));
+				m_chunks[1] = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + 32));
+#elif LIGHTNINGJSON_SSE2
+				for (int i = 0; i < 4; ++i)
+				{
+					m_chunks[i] = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i * 16));
+				}
+#else
+				memcpy(m_chunks, data, 64);
+#endif
+			}
+
+			uint64_t Eq(char c) const
+			{
+#if LIGHTNINGJSON_AVX2
+				__m256i const needle = _mm256_set1_epi8(c);
+				uint64_t const lo = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(m_chunks[0], needle)));
+				uint64_t const hi = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(m_chunks[1], needle)));
+				return lo | (hi << 32);
+#elif LIGHTNINGJSON_SSE2
+				__m128i const needle = _mm_set1_epi8(c);
+				uint64_t result = 0;
+				for (int i = 0; i < 4; ++i)
+				{
+					result |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(m_chunks[i], needle)))) << (i * 16);
+				}
+				return result;
+#else
+				uint64_t result = 0;
+				for (int i = 0; i < 64; ++i)
+				{
+					result |= uint64_t(m_chunks[i] == c) << i;
+				}
+				return result;
+#endif
+			}
+
+			uint64_t Whitespace() const
+			{
+				return Eq(' ') | Eq('\t') | Eq('\n') | Eq('\r');
+			}
+
+			uint64_t Operators() const
+			{
+				return Eq('{') | Eq('}') | Eq('[') | Eq(']') | Eq(':') | Eq(',');
+			}
+
+		private:
+#if LIGHTNINGJSON_AVX2
+			__m256i m_chunks[2];
+#elif LIGHTNINGJSON_SSE2
+			__m128i m_chunks[4];
+#else
+			char m_chunks[64];
+#endif
+		};
+	}
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifndef _WIN32
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#else
+#	include <Windows.h>
+#endif
+
+#include "Exceptions.hpp"
+
+namespace LightningJSON
+{
+	namespace detail_
+	{
+		// Reference-counted owner of the text a tree was parsed from. The root Holder of the tree
+		// holds the reference, so the text stays valid for as long as the root is alive.
+		class SourceBuffer
+		{
+		public:
+			// Maps the file read-only, or reads it into memory if it cannot be mapped.
+			static SourceBuffer* Open(char const* path);
+
+			char const* Data() const
+			{
+				return m_data;
+			}
+
+			size_t Size() const
+			{
+				return m_size;
+			}
+
+			// Hints that the mapping is about to be read front to back, or that the sequential read has finished.
+			void AdviseSequential(bool sequential);
+
+			void AddRef()
+			{
+				m_refCount.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void Release()
+			{
+				if (m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					delete this;
+				}
+			}
+
+		private:
+			SourceBuffer()
+				: m_refCount(0)
+				, m_data(nullptr)
+				, m_size(0)
+				, m_mapped(false)
+			{
+				//
+			}
+
+			~SourceBuffer();
+
+			std::atomic<int> m_refCount;
+			char* m_data;
+			size_t m_size;
+			bool m_mapped;
+		};
+
+		inline SourceBuffer* SourceBuffer::Open(char const* path)
+		{
+			SourceBuffer* source = new SourceBuffer();
+
+#ifdef _WIN32
+			HANDLE const file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			LARGE_INTEGER size;
+			if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size))
+			{
+				if (file != INVALID_HANDLE_VALUE)
+				{
+					CloseHandle(file);
+				}
+				delete source;
+				throw FileReadError();
+			}
+			source->m_size = size_t(size.QuadPart);
+
+			if (source->m_size != 0)
+			{
+				HANDLE const mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping)
+				{
+					source->m_data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+					CloseHandle(mapping);
+					source->m_mapped = source->m_data != nullptr;
+				}
+			}
+
+			if (!source->m_mapped)
+			{
+				source->m_data = static_cast<char*>(malloc(source->m_size + 1));
+				DWORD read = 0;
+				bool const ok = source->m_size == 0 || (ReadFile(file, source->m_data, DWORD(source->m_size), &read, nullptr) && read == source->m_size);
+				if (!ok)
+				{
+					CloseHandle(file);
+					delete source;
+					throw FileReadError();
+				}
+				source->m_data[source->m_size] = '\0';
+			}
+			CloseHandle(file);
+#else
+			int const fd = open(path, O_RDONLY);
+			struct stat info;
+			if (fd < 0 || fstat(fd, &info) != 0)
+			{
+				if (fd >= 0)
+				{
+					close(fd);
+				}
+				delete source;
+				throw FileReadError();
+			}
+			source->m_size = size_t(info.st_size);
+
+			if (source->m_size != 0)
+			{
+				void* const mapping = mmap(nullptr, source->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (mapping != MAP_FAILED)
+				{
+					source->m_data = static_cast<char*>(mapping);
+					source->m_mapped = true;
+				}
+			}
+
+			if (!source->m_mapped)
+			{
+				source->m_data = static_cast<char*>(malloc(source->m_size + 1));
+				size_t total = 0;
+				while (total < source->m_size)
+				{
+					ssize_t const read = ::read(fd, source->m_data + total, source->m_size - total);
+					if (read <= 0)
+					{
+						close(fd);
+						delete source;
+						throw FileReadError();
+					}
+					total += size_t(read);
+				}
+				source->m_data[source->m_size] = '\0';
+			}
+			close(fd);
+#endif
+
+			return source;
+		}
+
+		inline void SourceBuffer::AdviseSequential(bool sequential)
+		{
+#ifndef _WIN32
+			if (m_mapped)
+			{
+				madvise(m_data, m_size, sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+			}
+#else
+			(void)sequential;
+#endif
+		}
+
+		inline SourceBuffer::~SourceBuffer()
+		{
+			if (m_mapped)
+			{
+#ifdef _WIN32
+				UnmapViewOfFile(m_data);
+#else
+				munmap(m_data, m_size);
+#endif
+			}
+			else
+			{
+				free(m_data);
+			}
+		}
+	}
+}
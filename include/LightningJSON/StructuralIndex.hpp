@@ -0,0 +1,185 @@
+#pragma once
+
+#include <vector>
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "Exceptions.hpp"
+#include "Simd.hpp"
+
+namespace LightningJSON
+{
+	// Positions of every structural character in a JSON document: the operators {}[]:,
+	// outside of strings, every unescaped quote (both opening and closing), and the first
+	// character of every bare scalar (numbers, true, false, null).
+	// Built 64 bytes at a time so the tree builder can jump between tokens instead of
+	// examining every character. Offsets are 32-bit, so documents are limited to 4GB.
+	class StructuralIndex
+	{
+	public:
+		class Cursor
+		{
+		public:
+			Cursor(char const* base, char const* inputEnd, uint32_t const* pos, uint32_t const* end)
+				: m_base(base)
+				, m_inputEnd(inputEnd)
+				, m_pos(pos)
+				, m_end(end)
+			{
+				//
+			}
+
+			// Returns '\0' once the index has been exhausted, which every caller treats as invalid input.
+			char Peek() const
+			{
+				return m_pos < m_end ? m_base[*m_pos] : '\0';
+			}
+
+			char const* Pointer() const
+			{
+				return m_base + *m_pos;
+			}
+
+			// The end of the indexed text, which bounds scans over scalars.
+			char const* InputEnd() const
+			{
+				return m_inputEnd;
+			}
+
+			void Advance()
+			{
+				++m_pos;
+			}
+
+			bool AtEnd() const
+			{
+				return m_pos >= m_end;
+			}
+
+		private:
+			char const* m_base;
+			char const* m_inputEnd;
+			uint32_t const* m_pos;
+			uint32_t const* m_end;
+		};
+
+		StructuralIndex()
+			: m_data(nullptr)
+			, m_length(0)
+			, m_positions()
+		{
+			//
+		}
+
+		// length must not exceed UINT32_MAX.
+		void Build(char const* data, size_t length);
+
+		Cursor GetCursor() const
+		{
+			return Cursor(m_data, m_data + m_length, m_positions.data(), m_positions.data() + m_positions.size());
+		}
+
+		size_t Size() const
+		{
+			return m_positions.size();
+		}
+
+		uint32_t operator[](size_t index) const
+		{
+			return m_positions[index];
+		}
+
+	private:
+		// Returns a mask of the characters preceded by an odd-length run of backslashes.
+		static uint64_t FindEscaped(uint64_t backslash, uint64_t& prevEndsOddBackslash);
+		void IndexBlock(char const* block, size_t blockOffset, uint64_t& prevEscaped, uint64_t& prevInString, uint64_t& prevScalar);
+
+		char const* m_data;
+		size_t m_length;
+		std::vector<uint32_t> m_positions;
+	};
+
+	inline uint64_t StructuralIndex::FindEscaped(uint64_t backslash, uint64_t& prevEndsOddBackslash)
+	{
+		uint64_t const evenBits = 0x5555555555555555ULL;
+		uint64_t const oddBits = ~evenBits;
+
+		uint64_t const startEdges = backslash & ~(backslash << 1);
+		uint64_t const evenStartMask = evenBits ^ prevEndsOddBackslash;
+		uint64_t const evenStarts = startEdges & evenStartMask;
+		uint64_t const oddStarts = startEdges & ~evenStartMask;
+		uint64_t const evenCarries = backslash + evenStarts;
+
+		uint64_t oddCarries = backslash + oddStarts;
+		bool const endsOddBackslash = oddCarries < backslash;
+		oddCarries |= prevEndsOddBackslash;
+		prevEndsOddBackslash = endsOddBackslash ? 1 : 0;
+
+		uint64_t const evenCarryEnds = evenCarries & ~backslash;
+		uint64_t const oddCarryEnds = oddCarries & ~backslash;
+		return (evenCarryEnds & oddBits) | (oddCarryEnds & evenBits);
+	}
+
+	inline void StructuralIndex::IndexBlock(char const* block, size_t blockOffset, uint64_t& prevEscaped, uint64_t& prevInString, uint64_t& prevScalar)
+	{
+		detail_::Block64 const chars(block);
+
+		uint64_t const backslash = chars.Eq('\\');
+		uint64_t const escaped = backslash ? FindEscaped(backslash, prevEscaped) : prevEscaped;
+		if (!backslash)
+		{
+			prevEscaped = 0;
+		}
+
+		uint64_t const quotes = chars.Eq('"') & ~escaped;
+		// Covers each opening quote and the string contents, but not the closing quote.
+		uint64_t const inString = detail_::PrefixXor(quotes) ^ prevInString;
+		prevInString = uint64_t(int64_t(inString) >> 63);
+
+		uint64_t const operators = chars.Operators();
+		uint64_t const scalars = ~(operators | chars.Whitespace() | quotes) & ~inString;
+		uint64_t const scalarStarts = scalars & ~((scalars << 1) | prevScalar);
+		prevScalar = scalars >> 63;
+
+		uint64_t bits = (operators & ~inString) | quotes | scalarStarts;
+		while (bits)
+		{
+			m_positions.push_back(uint32_t(blockOffset + detail_::CountTrailingZeros(bits)));
+			bits &= bits - 1;
+		}
+	}
+
+	inline void StructuralIndex::Build(char const* data, size_t length)
+	{
+		m_data = data;
+		m_length = length;
+		m_positions.clear();
+		m_positions.reserve(length / 8 + 16);
+
+		uint64_t prevEscaped = 0;
+		uint64_t prevInString = 0;
+		uint64_t prevScalar = 0;
+
+		size_t offset = 0;
+		for (; offset + 64 <= length; offset += 64)
+		{
+			IndexBlock(data + offset, offset, prevEscaped, prevInString, prevScalar);
+		}
+
+		if (offset < length)
+		{
+			// Pad the tail with whitespace so it contributes no extra tokens.
+			char tail[64];
+			memset(tail, ' ', sizeof(tail));
+			memcpy(tail, data + offset, length - offset);
+			IndexBlock(tail, offset, prevEscaped, prevInString, prevScalar);
+		}
+
+		if (prevInString)
+		{
+			throw InvalidJSON();
+		}
+	}
+}
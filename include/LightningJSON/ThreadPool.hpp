@@ -0,0 +1,254 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stddef.h>
+
+namespace LightningJSON
+{
+	// A fixed set of worker threads with one task queue each. A worker takes tasks from the
+	// front of its own queue and, once that is empty, steals from the back of the others', so
+	// uneven tasks still keep every thread busy.
+	//
+	// Holders are allocated from per-thread pools. A Holder freed on a different thread than
+	// the one that allocated it is handed back to that thread's pool, so trees built by the
+	// workers can be used and destroyed anywhere, and the workers reuse the same blocks from
+	// one parse to the next.
+	class ThreadPool
+	{
+	public:
+		explicit ThreadPool(size_t threadCount);
+		~ThreadPool();
+
+		ThreadPool(ThreadPool const&) = delete;
+		ThreadPool& operator=(ThreadPool const&) = delete;
+
+		// A pool with one worker per hardware thread, started the first time it is used.
+		static ThreadPool& Shared()
+		{
+			static ThreadPool pool(std::thread::hardware_concurrency());
+			return pool;
+		}
+
+		size_t ThreadCount() const
+		{
+			return m_threads.size();
+		}
+
+		// Calls function(i) for every i in [0, count) across the workers and returns once all of
+		// the calls have finished. The calling thread helps while it waits. If any call throws,
+		// the first exception is rethrown here after the rest have finished.
+		void ParallelFor(size_t count, std::function<void(size_t)> const& function);
+
+	private:
+		struct Batch
+		{
+			Batch(std::function<void(size_t)> const& batchFunction, size_t count)
+				: function(batchFunction)
+				, remaining(count)
+				, error()
+				, errorMutex()
+			{
+				//
+			}
+
+			std::function<void(size_t)> const& function;
+			std::atomic<size_t> remaining;
+			std::exception_ptr error;
+			std::mutex errorMutex;
+		};
+
+		struct Task
+		{
+			Batch* batch;
+			size_t index;
+		};
+
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		void WorkerLoop(size_t queueIndex);
+		// Runs one task, preferring the given queue; returns false if every queue was empty.
+		bool TryRunOne(size_t queueIndex);
+		void Run(Task const& task);
+
+		std::vector<std::unique_ptr<Queue>> m_queues;
+		std::vector<std::thread> m_threads;
+		// Tasks that have been queued but not yet taken.
+		std::atomic<size_t> m_queued;
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_finished;
+		bool m_stopping;
+	};
+
+	inline ThreadPool::ThreadPool(size_t threadCount)
+		: m_queues()
+		, m_threads()
+		, m_queued(0)
+		, m_sleepMutex()
+		, m_wake()
+		, m_finished()
+		, m_stopping(false)
+	{
+		if (threadCount == 0)
+		{
+			threadCount = 1;
+		}
+		for (size_t i = 0; i < threadCount; ++i)
+		{
+			m_queues.emplace_back(new Queue());
+		}
+		for (size_t i = 0; i < threadCount; ++i)
+		{
+			m_threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+		}
+	}
+
+	inline ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_stopping = true;
+		}
+		m_wake.notify_all();
+		for (auto& thread : m_threads)
+		{
+			thread.join();
+		}
+	}
+
+	inline void ThreadPool::Run(Task const& task)
+	{
+		Batch* const batch = task.batch;
+		try
+		{
+			batch->function(task.index);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(batch->errorMutex);
+			if (!batch->error)
+			{
+				batch->error = std::current_exception();
+			}
+		}
+
+		if (batch->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_finished.notify_all();
+		}
+	}
+
+	inline bool ThreadPool::TryRunOne(size_t queueIndex)
+	{
+		size_t const queueCount = m_queues.size();
+		for (size_t i = 0; i < queueCount; ++i)
+		{
+			Queue& queue = *m_queues[(queueIndex + i) % queueCount];
+			Task task;
+			{
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				if (queue.tasks.empty())
+				{
+					continue;
+				}
+				// Take our own work from the front and steal from the back, so a thief takes
+				// the work its owner would have reached last.
+				if (i == 0)
+				{
+					task = queue.tasks.front();
+					queue.tasks.pop_front();
+				}
+				else
+				{
+					task = queue.tasks.back();
+					queue.tasks.pop_back();
+				}
+			}
+			m_queued.fetch_sub(1, std::memory_order_relaxed);
+			Run(task);
+			return true;
+		}
+		return false;
+	}
+
+	inline void ThreadPool::WorkerLoop(size_t queueIndex)
+	{
+		for (;;)
+		{
+			if (TryRunOne(queueIndex))
+			{
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_wake.wait(lock, [this] { return m_stopping || m_queued.load(std::memory_order_relaxed) != 0; });
+			if (m_stopping)
+			{
+				return;
+			}
+		}
+	}
+
+	inline void ThreadPool::ParallelFor(size_t count, std::function<void(size_t)> const& function)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		Batch batch(function, count);
+
+		// Hand each worker a contiguous range, so neighbouring tasks stay on one thread unless stolen.
+		size_t const queueCount = m_queues.size();
+		size_t const perQueue = (count + queueCount - 1) / queueCount;
+		for (size_t q = 0; q < queueCount; ++q)
+		{
+			size_t const begin = q * perQueue;
+			size_t const end = begin + perQueue < count ? begin + perQueue : count;
+			if (begin >= end)
+			{
+				break;
+			}
+			std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+			for (size_t i = begin; i < end; ++i)
+			{
+				m_queues[q]->tasks.push_back(Task{ &batch, i });
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_queued.fetch_add(count, std::memory_order_relaxed);
+		}
+		m_wake.notify_all();
+
+		while (batch.remaining.load(std::memory_order_acquire) != 0)
+		{
+			if (TryRunOne(0))
+			{
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_finished.wait(lock, [&batch] { return batch.remaining.load(std::memory_order_acquire) == 0; });
+		}
+
+		if (batch.error)
+		{
+			std::rethrow_exception(batch.error);
+		}
+	}
+}
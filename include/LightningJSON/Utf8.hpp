@@ -0,0 +1,395 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <string_view>
+
+#include "Simd.hpp"
+
+namespace LightningJSON
+{
+	// Returns true if [data, data + length) is well-formed UTF-8: no stray continuation bytes,
+	// no truncated, overlong or surrogate sequences, and nothing above U+10FFFF.
+	bool ValidateUtf8(char const* data, size_t length);
+
+	inline bool ValidateUtf8(std::string_view const& str)
+	{
+		return ValidateUtf8(str.data(), str.length());
+	}
+
+	namespace detail_
+	{
+		// Checks one sequence starting at a non-ASCII lead byte and returns its length, or 0 if it is invalid.
+		inline size_t ValidateUtf8Sequence(unsigned char const* data, unsigned char const* end)
+		{
+			unsigned char const lead = data[0];
+			size_t length;
+			unsigned char min = 0x80;
+			unsigned char max = 0xBF;
+			if (lead >= 0xC2 && lead <= 0xDF)
+			{
+				length = 2;
+			}
+			else if (lead >= 0xE0 && lead <= 0xEF)
+			{
+				length = 3;
+				if (lead == 0xE0)
+				{
+					min = 0xA0;	// Overlong
+				}
+				else if (lead == 0xED)
+				{
+					max = 0x9F;	// Surrogates
+				}
+			}
+			else if (lead >= 0xF0 && lead <= 0xF4)
+			{
+				length = 4;
+				if (lead == 0xF0)
+				{
+					min = 0x90;	// Overlong
+				}
+				else if (lead == 0xF4)
+				{
+					max = 0x8F;	// Above U+10FFFF
+				}
+			}
+			else
+			{
+				return 0;
+			}
+
+			if (size_t(end - data) < length || data[1] < min || data[1] > max)
+			{
+				return 0;
+			}
+			for (size_t i = 2; i < length; ++i)
+			{
+				if ((data[i] & 0xC0) != 0x80)
+				{
+					return 0;
+				}
+			}
+			return length;
+		}
+
+		// Returns the length of the sequence a lead byte starts: 1 for ASCII, and 0 for a byte
+		// that cannot start one.
+		inline size_t Utf8SequenceLength(unsigned char lead)
+		{
+			if (lead < 0x80)
+			{
+				return 1;
+			}
+			if (lead >= 0xC2 && lead <= 0xDF)
+			{
+				return 2;
+			}
+			if (lead >= 0xE0 && lead <= 0xEF)
+			{
+				return 3;
+			}
+			if (lead >= 0xF0 && lead <= 0xF4)
+			{
+				return 4;
+			}
+			return 0;
+		}
+
+		// Returns how many bytes at the end of [data, data + length) begin a sequence that runs
+		// past the end: at most 3, and 0 if the last sequence is complete or cannot be valid.
+		inline size_t IncompleteUtf8Tail(char const* data, size_t length)
+		{
+			for (size_t back = 1; back <= 3 && back <= length; ++back)
+			{
+				unsigned char const c = static_cast<unsigned char>(data[length - back]);
+				if ((c & 0xC0) != 0x80)
+				{
+					return Utf8SequenceLength(c) > back ? back : 0;
+				}
+			}
+			return 0;
+		}
+
+		// The value of each hexadecimal digit, indexed by character, and 0xFF for anything else.
+		alignas(64) inline constexpr uint8_t HexDigitValues[256] = {
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 10, 11, 12, 13, 14, 15, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 10, 11, 12, 13, 14, 15, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		};
+
+		// Decodes the four hex digits of a \u escape, or returns -1 if any of them is not a hex digit.
+		inline int32_t DecodeHex4(char const* data)
+		{
+			uint32_t const a = HexDigitValues[uint8_t(data[0])];
+			uint32_t const b = HexDigitValues[uint8_t(data[1])];
+			uint32_t const c = HexDigitValues[uint8_t(data[2])];
+			uint32_t const d = HexDigitValues[uint8_t(data[3])];
+			if ((a | b | c | d) > 0xF)
+			{
+				return -1;
+			}
+			return int32_t((a << 12) | (b << 8) | (c << 4) | d);
+		}
+
+		// Writes a code point below U+110000 as UTF-8 and returns the number of bytes written.
+		inline size_t EncodeUtf8(uint32_t codePoint, char* out)
+		{
+			if (codePoint < 0x80)
+			{
+				out[0] = char(codePoint);
+				return 1;
+			}
+			if (codePoint < 0x800)
+			{
+				out[0] = char(0xC0 | (codePoint >> 6));
+				out[1] = char(0x80 | (codePoint & 0x3F));
+				return 2;
+			}
+			if (codePoint < 0x10000)
+			{
+				out[0] = char(0xE0 | (codePoint >> 12));
+				out[1] = char(0x80 | ((codePoint >> 6) & 0x3F));
+				out[2] = char(0x80 | (codePoint & 0x3F));
+				return 3;
+			}
+			out[0] = char(0xF0 | (codePoint >> 18));
+			out[1] = char(0x80 | ((codePoint >> 12) & 0x3F));
+			out[2] = char(0x80 | ((codePoint >> 6) & 0x3F));
+			out[3] = char(0x80 | (codePoint & 0x3F));
+			return 4;
+		}
+
+		inline bool ValidateUtf8Scalar(unsigned char const* data, unsigned char const* end)
+		{
+			while (data < end)
+			{
+#if LIGHTNINGJSON_SSE2
+				// Skip ASCII a vector at a time where SSSE3 is not available for the checker below.
+				if (size_t(end - data) >= VectorSize && MoveMask(LoadUnaligned(reinterpret_cast<char const*>(data))) == 0)
+				{
+					data += VectorSize;
+					continue;
+				}
+#endif
+				// Skip ASCII eight bytes at a time.
+				if (end - data >= 8)
+				{
+					uint64_t word;
+					memcpy(&word, data, 8);
+					if ((word & 0x8080808080808080ULL) == 0)
+					{
+						data += 8;
+						continue;
+					}
+				}
+				if (*data < 0x80)
+				{
+					++data;
+					continue;
+				}
+				size_t const length = ValidateUtf8Sequence(data, end);
+				if (length == 0)
+				{
+					return false;
+				}
+				data += length;
+			}
+			return true;
+		}
+
+#if LIGHTNINGJSON_SSSE3
+		// Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte" (2021).
+		// Every error in a two-byte window is identified by three 16-entry lookups: the high and
+		// low nibbles of the first byte and the high nibble of the second. Their AND is nonzero
+		// exactly when the pair is invalid, except for the third and fourth bytes of longer
+		// sequences, which are matched up separately. Works a Vector at a time, so 32 bytes with
+		// AVX2 and 16 with SSSE3.
+		class Utf8Checker
+		{
+		public:
+			Utf8Checker()
+				: m_previous(Zero())
+				, m_error(Zero())
+				, m_previousIncomplete(Zero())
+			{
+				//
+			}
+
+			void Check(Vector input)
+			{
+				if (MoveMask(input) == 0)
+				{
+					// All ASCII; only a sequence left open by the previous block can be wrong.
+					m_error = Or(m_error, m_previousIncomplete);
+					m_previousIncomplete = Zero();
+				}
+				else
+				{
+					Vector const prev1 = Previous<1>(m_previous, input);
+					Vector const special = SpecialCases(input, prev1);
+					m_error = Or(m_error, CheckMultibyteLengths(input, special));
+					m_previousIncomplete = IsIncomplete(input);
+				}
+				m_previous = input;
+			}
+
+			bool Finish()
+			{
+				m_error = Or(m_error, m_previousIncomplete);
+				return IsZero(m_error);
+			}
+
+		private:
+			static constexpr uint8_t ms_tooShort = 1 << 0;		// 11______ 0_______
+			static constexpr uint8_t ms_tooLong = 1 << 1;		// 0_______ 10______
+			static constexpr uint8_t ms_overlong3 = 1 << 2;		// 11100000 100_____
+			static constexpr uint8_t ms_tooLarge = 1 << 3;		// 11110100 1001____
+			static constexpr uint8_t ms_surrogate = 1 << 4;		// 11101101 101_____
+			static constexpr uint8_t ms_overlong2 = 1 << 5;		// 1100000_ 10______
+			static constexpr uint8_t ms_tooLarge1000 = 1 << 6;	// 11110101+ 1000____
+			static constexpr uint8_t ms_overlong4 = 1 << 6;		// 11110000 1000____
+			static constexpr uint8_t ms_twoConts = 1 << 7;		// 10______ 10______
+			static constexpr uint8_t ms_carry = ms_tooShort | ms_tooLong | ms_twoConts;
+
+			static Vector Table(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4, uint8_t b5, uint8_t b6, uint8_t b7,
+				uint8_t b8, uint8_t b9, uint8_t b10, uint8_t b11, uint8_t b12, uint8_t b13, uint8_t b14, uint8_t b15)
+			{
+				__m128i const table = _mm_setr_epi8(
+					char(b0), char(b1), char(b2), char(b3), char(b4), char(b5), char(b6), char(b7),
+					char(b8), char(b9), char(b10), char(b11), char(b12), char(b13), char(b14), char(b15));
+#	if LIGHTNINGJSON_AVX2
+				return _mm256_broadcastsi128_si256(table);
+#	else
+				return table;
+#	endif
+			}
+
+			static Vector SpecialCases(Vector input, Vector prev1)
+			{
+				Vector const byte1High = Lookup16(Table(
+					// 0_______ ________ <ASCII in byte 1>
+					ms_tooLong, ms_tooLong, ms_tooLong, ms_tooLong,
+					ms_tooLong, ms_tooLong, ms_tooLong, ms_tooLong,
+					// 10______ ________ <continuation in byte 1>
+					ms_twoConts, ms_twoConts, ms_twoConts, ms_twoConts,
+					// 1100____ ________ <two byte lead in byte 1>
+					ms_tooShort | ms_overlong2,
+					// 1101____ ________ <two byte lead in byte 1>
+					ms_tooShort,
+					// 1110____ ________ <three byte lead in byte 1>
+					ms_tooShort | ms_overlong3 | ms_surrogate,
+					// 1111____ ________ <four+ byte lead in byte 1>
+					ms_tooShort | ms_tooLarge | ms_tooLarge1000 | ms_overlong4), HighNibbles(prev1));
+
+				Vector const byte1Low = Lookup16(Table(
+					// ____0000 ________
+					ms_carry | ms_overlong3 | ms_overlong2 | ms_overlong4,
+					// ____0001 ________
+					ms_carry | ms_overlong2,
+					// ____001_ ________
+					ms_carry,
+					ms_carry,
+					// ____0100 ________
+					ms_carry | ms_tooLarge,
+					// ____0101 ________
+					ms_carry | ms_tooLarge | ms_tooLarge1000,
+					// ____011_ ________
+					ms_carry | ms_tooLarge | ms_tooLarge1000,
+					ms_carry | ms_tooLarge | ms_tooLarge1000,
+					// ____1___ ________
+					ms_carry | ms_tooLarge | ms_tooLarge1000,
+					ms_carry | ms_tooLarge | ms_tooLarge1000,
+					ms_carry | ms_tooLarge | ms_tooLarge1000,
+					ms_carry | ms_tooLarge | ms_tooLarge1000,
+					ms_carry | ms_tooLarge | ms_tooLarge1000,
+					// ____1101 ________
+					ms_carry | ms_tooLarge | ms_tooLarge1000 | ms_surrogate,
+					ms_carry | ms_tooLarge | ms_tooLarge1000,
+					ms_carry | ms_tooLarge | ms_tooLarge1000), And(prev1, Splat(0x0F)));
+
+				Vector const byte2High = Lookup16(Table(
+					// ________ 0_______ <ASCII in byte 2>
+					ms_tooShort, ms_tooShort, ms_tooShort, ms_tooShort,
+					ms_tooShort, ms_tooShort, ms_tooShort, ms_tooShort,
+					// ________ 1000____
+					ms_tooLong | ms_overlong2 | ms_twoConts | ms_overlong3 | ms_tooLarge1000 | ms_overlong4,
+					// ________ 1001____
+					ms_tooLong | ms_overlong2 | ms_twoConts | ms_overlong3 | ms_tooLarge,
+					// ________ 101_____
+					ms_tooLong | ms_overlong2 | ms_twoConts | ms_surrogate | ms_tooLarge,
+					ms_tooLong | ms_overlong2 | ms_twoConts | ms_surrogate | ms_tooLarge,
+					// ________ 11______
+					ms_tooShort, ms_tooShort, ms_tooShort, ms_tooShort), HighNibbles(input));
+
+				return And(And(byte1High, byte1Low), byte2High);
+			}
+
+			Vector CheckMultibyteLengths(Vector input, Vector special) const
+			{
+				// A byte two after a 3+ byte lead, or three after a 4 byte lead, must be a
+				// continuation; SpecialCases flagged it as one of two in a row, which cancels out.
+				Vector const isThirdByte = SubtractSaturated(Previous<2>(m_previous, input), Splat(char(0xE0 - 0x80)));
+				Vector const isFourthByte = SubtractSaturated(Previous<3>(m_previous, input), Splat(char(0xF0 - 0x80)));
+				Vector const must23 = And(Or(isThirdByte, isFourthByte), Splat(char(0x80)));
+				return Xor(must23, special);
+			}
+
+			// Nonzero where a lead byte near the end of the block still needs continuation bytes.
+			static Vector IsIncomplete(Vector input)
+			{
+				// The largest byte allowed at each position: anything in the last three bytes that
+				// starts a sequence too long to fit in the block is left nonzero.
+				alignas(32) static constexpr uint8_t maxValues[32] = {
+					255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+					255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+				};
+				return SubtractSaturated(input, LoadUnaligned(reinterpret_cast<char const*>(maxValues) + 32 - VectorSize));
+			}
+
+			Vector m_previous;
+			Vector m_error;
+			Vector m_previousIncomplete;
+		};
+#endif
+	}
+
+	inline bool ValidateUtf8(char const* data, size_t length)
+	{
+#if LIGHTNINGJSON_SSSE3
+		detail_::Utf8Checker checker;
+		size_t offset = 0;
+		for (; offset + detail_::VectorSize <= length; offset += detail_::VectorSize)
+		{
+			checker.Check(detail_::LoadUnaligned(data + offset));
+		}
+		if (offset < length)
+		{
+			// Zero padding is ASCII, so it never hides or adds an error.
+			char tail[detail_::VectorSize];
+			memset(tail, 0, sizeof(tail));
+			memcpy(tail, data + offset, length - offset);
+			checker.Check(detail_::LoadUnaligned(tail));
+		}
+		return checker.Finish();
+#else
+		unsigned char const* const begin = reinterpret_cast<unsigned char const*>(data);
+		return detail_::ValidateUtf8Scalar(begin, begin + length);
+#endif
+	}
+}